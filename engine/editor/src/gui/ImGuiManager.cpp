@@ -9,6 +9,7 @@
 namespace ImGuiManager {
     std::unique_ptr<ControlsWindow> controlsWindow;
     std::unique_ptr<LoggingWindow> loggingWindow;
+    std::unique_ptr<ListenerProfilerWindow> listenerProfilerWindow;
 }
 
 void ImGuiManager::init(GLFWwindow* window) {
@@ -21,6 +22,7 @@ void ImGuiManager::init(GLFWwindow* window) {
 
     controlsWindow = std::make_unique<ControlsWindow>();
     loggingWindow = std::make_unique<LoggingWindow>();
+    listenerProfilerWindow = std::make_unique<ListenerProfilerWindow>();
 
     Logging::linkLoggingWindow(loggingWindow.get());
 }
@@ -32,14 +34,20 @@ void ImGuiManager::render() {
 
     controlsWindow->draw();
     loggingWindow->draw();
+    listenerProfilerWindow->draw();
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+void ImGuiManager::linkEventDispatcher(HeimskrEngine::EventDispatcher* dispatcher) {
+    listenerProfilerWindow->setDispatcher(dispatcher);
+}
+
 void ImGuiManager::shutdown() {
     controlsWindow = nullptr;
     loggingWindow = nullptr;
+    listenerProfilerWindow = nullptr;
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -5,15 +5,19 @@
 #include <memory>
 
 #include "ControlsWindow.h"
+#include "ListenerProfilerWindow.h"
 #include "LoggingWindow.h"
 
 namespace ImGuiManager {
     void init(GLFWwindow* window);
     void render();
     void shutdown();
+    // Must be called after init(), with the dispatcher of the application, for the listener profiler to show anything.
+    void linkEventDispatcher(HeimskrEngine::EventDispatcher* dispatcher);
 
     extern std::unique_ptr<ControlsWindow> controlsWindow;
     extern std::unique_ptr<LoggingWindow> loggingWindow;
+    extern std::unique_ptr<ListenerProfilerWindow> listenerProfilerWindow;
 }
 
 #endif //IMGUIMANAGER_H
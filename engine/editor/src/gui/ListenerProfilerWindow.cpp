@@ -0,0 +1,79 @@
+#include "ListenerProfilerWindow.h"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+    double toMilliseconds(std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+ListenerProfilerWindow::ListenerProfilerWindow() : _dispatcher(nullptr) {}
+
+void ListenerProfilerWindow::draw() {
+    ImGui::Begin("Event listeners");
+    if (_dispatcher == nullptr) {
+        ImGui::TextUnformatted("No event dispatcher linked.");
+        ImGui::End();
+        return;
+    }
+
+    bool profiling = _dispatcher->IsProfiling();
+    if (ImGui::Checkbox("Profile", &profiling)) {
+        _dispatcher->SetProfiling(profiling);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset")) {
+        _dispatcher->ResetProfiles();
+    }
+    ImGui::SameLine();
+    _filter.Draw("Filter", -100.0f);
+#ifndef HEIMSKR_ENGINE_PROFILE_EVENTS
+    ImGui::TextUnformatted("Build with HEIMSKR_ENGINE_PROFILE_EVENTS to measure the listeners.");
+#endif
+    ImGui::Separator();
+
+    // The most expensive listeners first, so the one causing a spike stands out.
+    std::vector<HeimskrEngine::ListenerProfile> profiles = _dispatcher->GetProfiles();
+    std::sort(profiles.begin(), profiles.end(), [](const auto &a, const auto &b) { return a.Total > b.Total; });
+
+    constexpr ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("listeners", 6, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Event");
+        ImGui::TableSetupColumn("Listener");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Total (ms)");
+        ImGui::TableSetupColumn("Average (ms)");
+        ImGui::TableSetupColumn("Max (ms)");
+        ImGui::TableHeadersRow();
+
+        for (const auto &profile : profiles) {
+            const std::string listener = profile.Listener.empty() ? std::to_string(profile.ListenerId) : std::string(profile.Listener);
+            const std::string event(profile.Event);
+            if (!_filter.PassFilter(event.c_str()) && !_filter.PassFilter(listener.c_str())) {
+                continue;
+            }
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(event.c_str());
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(listener.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(profile.Calls));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", toMilliseconds(profile.Total));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", profile.Calls == 0 ? 0.0 : toMilliseconds(profile.Total) / static_cast<double>(profile.Calls));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", toMilliseconds(profile.Max));
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+void ListenerProfilerWindow::setDispatcher(HeimskrEngine::EventDispatcher *dispatcher) {
+    _dispatcher = dispatcher;
+}
@@ -0,0 +1,18 @@
+#ifndef LISTENERPROFILERWINDOW_H
+#define LISTENERPROFILERWINDOW_H
+
+#include <imgui.h>
+
+#include "../../../src/common/Event.h"
+
+class ListenerProfilerWindow {
+public:
+    explicit ListenerProfilerWindow();
+    void draw();
+    void setDispatcher(HeimskrEngine::EventDispatcher *dispatcher);
+private:
+    HeimskrEngine::EventDispatcher *_dispatcher;
+    ImGuiTextFilter _filter;
+};
+
+#endif //LISTENERPROFILERWINDOW_H
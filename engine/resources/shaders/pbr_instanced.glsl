@@ -0,0 +1,47 @@
+#version 330 core
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in vec3 in_normal;
+layout (location = 2) in vec2 in_uvs;
+// Index in the instance buffer of the drawn instance, read from the batch buffer at the base instance of the draw (see GeometryArena::InstanceAttribute).
+layout (location = 3) in uint in_instance;
+
+// A single draw covers every instance of a batch (see RenderBatch).
+// The instance buffer holds the per-instance data of every mesh entity, 5 texels per instance (see InstanceData).
+// The first 4 texels are the columns of the model matrix, the last one holds the material index.
+uniform samplerBuffer u_instances;
+// Per-frame data, shared by every program and updated once per frame (see FrameUniforms).
+layout (std140) uniform FrameBlock {
+    // x: time in seconds, y: time since the last frame.
+    vec4 u_time;
+    // xy: size of the frame buffer in pixels, zw: its inverse.
+    vec4 u_resolution;
+};
+// Per-view data, shared by every program and updated once per view (see ViewUniforms).
+layout (std140) uniform ViewBlock {
+    // The view matrix represents the camera's position and orientation in the world.
+    mat4 u_view;
+    // The projection matrix deals with the camera's field of view, aspect ratio, and near/far clipping planes to transform a 3D point into a 2D screen space.
+    mat4 u_projection;
+    // Projection * View, multiplied once per view instead of once per vertex.
+    mat4 u_view_projection;
+    vec4 u_camera_position;
+};
+
+mat4 instance_model(int index) {
+    int texel = index * 5;
+    return mat4(texelFetch(u_instances, texel), texelFetch(u_instances, texel + 1), texelFetch(u_instances, texel + 2), texelFetch(u_instances, texel + 3));
+}
+
+void main() {
+    gl_Position = u_view_projection * instance_model(int(in_instance)) * vec4(in_position, 1.0);
+}
+
+++VERTEX++
+
+#version 330 core
+layout(location = 0) out vec4 out_fragment;
+void main() {
+    out_fragment = vec4(0.6, 0.5, 0.7, 1.0);
+}
+
+++FRAGMENT++
\ No newline at end of file
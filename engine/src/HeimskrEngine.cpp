@@ -108,6 +108,7 @@ int main() {
 	//glViewport(0, 0, 800, 800);
 
 	//ImGuiManager::init(window);
+	//ImGuiManager::linkEventDispatcher(&dispatcher);
 
 	//GCS_LOG_TRACE("Starting program");
 
@@ -4,17 +4,37 @@
  */
 
 #pragma once
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include "Interface.h"
 
 namespace HeimskrEngine {
   class Application : public AppInterface {
   public:
-    Application() {
-      context = new AppContext();
+    Application(const AppSettings& settings = {}) {
+      context = new AppContext(settings);
       id = TypeID<Application>();
+      context->EventDispatcher.SetListenerName(id, "Application");
 
+      // The resize is applied by the renderer, which might run on another thread, through the next frame data.
       AttachCallback<WindowResizeEvent>([this](auto e) {
-        context->Renderer->Resize(e.Width, e.Height);
+        pendingWidth = e.Width;
+        pendingHeight = e.Height;
+        if (e.Width > 0 && e.Height > 0) {
+          viewportRatio = static_cast<float>(e.Width) / static_cast<float>(e.Height);
+        }
+      });
+
+      // The layers tick at the primary rate, whose ticks also drive the transform interpolation.
+      fixedUpdate = context->SimulationClock.AddSystem(context->Settings.FixedUpdateRate, [this](double step) {
+        context->SceneRegistry.view<InterpolatedTransformComponent, TransformComponent>().each([](auto& interpolated, const auto& transform) {
+          interpolated.Previous = transform.Transform;
+        });
+        for (const auto& layer : context->Layers) {
+          layer->OnFixedUpdate(step);
+        }
       });
     }
 
@@ -26,43 +46,188 @@ namespace HeimskrEngine {
     }
 
     /**
-     * \brief Update every layers in the context and poll for events.
+     * \brief Update every layers in the context and poll for events, until the window is closed.
+     * \details Depending on AppSettings::PipelinedRendering, the frames are rendered on the calling thread right after their simulation, or on a dedicated render thread while the next frame is simulated.
      */
-    [[noreturn]]
     void RunContext() {
       auto camera = CreateEntity<Entity>();
       camera.Attach<CameraComponent>();
-      camera.Attach<TransformComponent>().Transform.Translation.z = 2.0f;
+      camera.Attach<TransformComponent>();
+      camera.Patch<TransformComponent>([](auto& component) { component.Transform.Translation.z = 2.0f; });
 
       auto quad = CreateEntity<Entity>();
       quad.Attach<TransformComponent>();
-      quad.Attach<MeshComponent>().Mesh = CreateQuad3D();
+      quad.Attach<MeshComponent>();
+      quad.Patch<MeshComponent>([](auto& component) { component.Mesh = CreateQuad3D(); });
 
-      while (context->Window->PollEvents()) {
+      if (context->Settings.PipelinedRendering) {
+        RunPipelined();
+      } else {
+        RunLockstep();
+      }
+    }
 
-        context->Renderer->BeginFrame();
-        //context->Renderer->Resize(100, 100);
+  private:
+    /**
+     * \brief Simulates and renders every frame on the calling thread.
+     */
+    void RunLockstep() {
+      FrameData frame;
+      for (uint64_t index = 0u;; ++index) {
+        frame.Reset(index);
+        if (!context->Window->PollEvents()) {
+          break;
+        }
+        Simulate(frame);
+        Render(frame);
+      }
+    }
 
-        // Setting the camera shader
-        EntityView<Entity, CameraComponent>([this](auto entity, auto& component) {
-          auto& transform = entity.template Get<TransformComponent>().Transform;
-          context->Renderer->SetCamera(component.Camera, transform);
-        });
 
-        // Settings the mesh shader
-        EntityView<Entity, MeshComponent>([this](auto entity, auto& component) {
-          auto& transform = entity.template Get<TransformComponent>().Transform;
-          context->Renderer->Draw(component.Mesh, transform);
-        });
+    /**
+     * \brief Simulates the frames on the calling thread while a render thread owning the GL context draws the previous ones.
+     */
+    void RunPipelined() {
+      FramePipeline pipeline(context->Settings.FrameLatency);
 
-        context->Renderer->EndFrame();
+      Window::ReleaseContext();
+      std::thread renderThread([this, &pipeline] {
+        context->Window->MakeContextCurrent();
+        while (FrameData* frame = pipeline.AcquireRender()) {
+          Render(*frame);
+          pipeline.Release(frame);
+        }
+        Window::ReleaseContext();
+      });
 
-        for (const auto& layer : context->Layers) {
-          layer->OnUpdate();
+      for (uint64_t index = 0u;; ++index) {
+        FrameData* frame = pipeline.AcquireSimulation();
+        // Resetting before polling so the measured latency starts at the input.
+        frame->Reset(index);
+        if (!context->Window->PollEvents()) {
+          pipeline.Release(frame);
+          break;
         }
+        Simulate(*frame);
+        pipeline.Publish(frame);
+      }
+
+      pipeline.Close();
+      renderThread.join();
+      // The GL resources are destroyed with the context, from the main thread.
+      context->Window->MakeContextCurrent();
+    }
+
 
-        context->Renderer->ShowFrame();
+    /**
+     * \brief Updates the layers and fills the frame data from the scene registry.
+     * \param frame The frame data to fill, already reset.
+     */
+    void Simulate(FrameData& frame) {
+      frame.Width = pendingWidth;
+      frame.Height = pendingHeight;
+      pendingWidth = 0;
+      pendingHeight = 0;
+
+      // Snapshotting the layers, since the render thread must not walk the list the simulation attaches layers to
+      frame.Layers.assign(context->Layers.begin(), context->Layers.end());
+      frame.DetachedLayers.swap(context->DetachedLayers);
+
+      // Announcing the assets completed by the GL thread, the events are dispatched on the next poll.
+      context->AssetLoader->Dispatch(context->EventDispatcher);
+
+      // Running the fixed-rate systems for the real time elapsed since the last frame
+      const std::chrono::duration<double> elapsed = lastSimulation == std::chrono::steady_clock::time_point() ? std::chrono::duration<double>::zero() : frame.SimulationStart - lastSimulation;
+      lastSimulation = frame.SimulationStart;
+      context->SimulationClock.Advance(elapsed.count());
+      const auto alpha = static_cast<float>(context->SimulationClock.GetAlpha(fixedUpdate));
+      frame.Time = context->SimulationClock.GetTime();
+      frame.DeltaTime = static_cast<float>(elapsed.count());
+
+      // Resuming the coroutines whose frame, timer or event came
+      context->Coroutines.Resume(context->SimulationClock.GetTime());
+
+      for (const auto& layer : context->Layers) {
+        layer->OnUpdate();
+      }
+
+      // Running the background tasks within the headroom measured on the last frames
+      const FrameTimings timings = context->FrameStatistics.Get();
+      const double simulationMs = std::max(timings.SimulationMs - context->BackgroundScheduler.GetUsedMs(), 0.0);
+      const double busyMs = context->Settings.PipelinedRendering ? std::max(simulationMs, timings.RenderMs) : simulationMs + timings.RenderMs;
+      context->BackgroundScheduler.Adapt(busyMs, context->Settings.TargetFrameMs);
+      context->BackgroundScheduler.Run();
+
+      // Setting the camera shader
+      EntityView<Entity, CameraComponent>([&frame, alpha](auto entity, auto& component) {
+        frame.HasCamera = true;
+        frame.Camera = component.Camera;
+        frame.CameraTransform = entity.template Get<TransformComponent>().Transform;
+        if (entity.template Has<InterpolatedTransformComponent>()) {
+          const auto& previous = entity.template Get<InterpolatedTransformComponent>().Previous;
+          frame.CameraTransform = Transform3D::Interpolate(previous, frame.CameraTransform, alpha);
+        }
+      });
+
+      // Copying the instance data of the entities that changed since the last frame
+      context->RenderExtractor.Extract(alpha);
+      context->RenderExtractor.Flush(frame);
+      context->RenderExtractor.UpdateHierarchy(context->BackgroundScheduler);
+
+      // Culling the instances outside the view, then recording the draws of the visible ones on every worker, sorted by depth from the up-to-date instances, then merging them with the draws of the layers
+      if (frame.HasCamera) {
+        context->RenderCommands->SetCamera(frame.Camera, frame.CameraTransform);
+        context->RenderExtractor.Cull(FrustumPlanes::FromMatrix(frame.Camera.Frustum(frame.CameraTransform, viewportRatio)), *context->JobSystem);
       }
+      frame.VisibleInstances = context->RenderExtractor.GetStats().Visible;
+      frame.CulledInstances = context->RenderExtractor.GetStats().Culled;
+      context->RenderExtractor.Record(*context->RenderCommands, *context->JobSystem);
+      context->RenderCommands->Merge(frame.Commands, frame.TransientInstances, frame.Meshes);
+      RenderCommandQueue::Batch(frame.Commands, frame.Batches, frame.BatchInstances);
+
+      const std::chrono::duration<double, std::milli> simulation = std::chrono::steady_clock::now() - frame.SimulationStart;
+      context->FrameStatistics.RecordSimulation(simulation.count());
+    }
+
+
+    /**
+     * \brief Renders and shows a frame. Must be called from the thread owning the GL context.
+     * \param frame The frame data filled by Simulate().
+     */
+    void Render(FrameData& frame) {
+      const auto start = std::chrono::steady_clock::now();
+
+      // Spreading the GPU uploads of the loading assets over the frames.
+      context->AssetLoader->Upload(context->Settings.AssetUploadBudget);
+      context->Renderer->Render(frame);
+      // Going through the layers of the frame, the simulation thread being free to attach or detach layers meanwhile.
+      for (const auto& layer : frame.Layers) {
+        layer->OnRender();
+      }
+      context->Renderer->ShowFrame();
+      context->Window->SwapBuffers();
+
+      // Dropping the mesh references here, so a mesh whose entity was destroyed is released with the GL context current.
+      frame.Meshes.clear();
+      frame.ReleasedMeshes.clear();
+      // The frames are rendered in order, so no frame left references the layers detached before this one.
+      for (auto& layer : frame.DetachedLayers) {
+        delete layer;
+        layer = nullptr;
+      }
+      frame.DetachedLayers.clear();
+
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      context->FrameStatistics.RecordRender(frame, elapsed.count(), context->Renderer->GetStats());
     }
+
+  private:
+    // Only accessed from the simulation thread, which polls the window events.
+    int32_t pendingWidth = 0;
+    int32_t pendingHeight = 0;
+    // Aspect ratio of the frame buffer, for the frustum culling. The renderer starts with a square frame buffer.
+    float viewportRatio = 1.0f;
+    std::chrono::steady_clock::time_point lastSimulation;
+    uint32_t fixedUpdate = SimulationClock::InvalidSystem;
   };
 }
@@ -8,9 +8,19 @@
 #include <vector>
 
 #include "Interface.h"
+#include "FramePipeline.h"
+#include "Settings.h"
+#include "../assets/AssetLoader.h"
 #include "../common/Event.h"
+#include "../core/Coroutine.h"
+#include "../core/JobSystem.h"
+#include "../core/SimulationClock.h"
+#include "../core/TimeSlicedScheduler.h"
 #include "../ecs/ECS.h"
+#include "../ecs/NameIndex.h"
 #include "../window/Window.h"
+#include "../graphics/RenderCommands.h"
+#include "../graphics/RenderExtractor.h"
 #include "../graphics/Renderer.h"
 
 namespace HeimskrEngine {
@@ -18,9 +28,23 @@ namespace HeimskrEngine {
 
   class AppContext {
   public:
-    AppContext() {
+    explicit AppContext(const AppSettings& settings = {}) : Settings(settings), BackgroundScheduler(settings.BackgroundBudgetMs), Coroutines(&EventDispatcher) {
+      // Created first so the main thread is registered as worker 0 before anything submits jobs.
+      JobSystem = std::make_unique<class JobSystem>();
+      RenderCommands = std::make_unique<RenderCommandQueue>(JobSystem->GetThreadCount());
       Window = std::make_unique<class Window>(&EventDispatcher, 1280, 1280, "Heimskr Engine");
+      Window->SetVSync(Settings.VSync);
       Renderer = std::make_unique<class Renderer>(1280, 1280);
+      AssetLoader = std::make_unique<class AssetLoader>(Settings.AssetThreads);
+      RenderExtractor.Connect(SceneRegistry);
+      NameIndex.Connect(SceneRegistry);
+
+      if (!Settings.RecordEventsPath.empty() && !EventDispatcher.StartRecording(Settings.RecordEventsPath)) {
+        HEIMSKR_ERROR(fmt::format("Could not record the events to {}", Settings.RecordEventsPath));
+      }
+      if (!Settings.ReplayEventsPath.empty() && !EventDispatcher.StartReplay(Settings.ReplayEventsPath)) {
+        HEIMSKR_ERROR(fmt::format("Could not replay the events from {}", Settings.ReplayEventsPath));
+      }
     }
 
     ~AppContext() {
@@ -31,15 +55,62 @@ namespace HeimskrEngine {
         delete layer;
         layer = nullptr;
       }
+      // The layers detached by the last polled events never reached a frame.
+      for (auto& layer : DetachedLayers) {
+        delete layer;
+        layer = nullptr;
+      }
     }
 
     /**
      * \brief Layers are object can be seem as extensions adding functionalities to the engine. They allow the user to manipulate the engine's unused functionalities.
      */
     std::vector<AppInterface*> Layers;
+    /**
+     * \brief The attached layers indexed by TypeIndex<AppInterface>, null for the types that are not attached, so finding a layer is a single load.
+     */
+    std::vector<AppInterface*> LayerIndex;
+    /**
+     * \brief Layers detached since the last simulated frame. They are handed to that frame and deleted once it is rendered, since the frames before it might still be drawing them.
+     */
+    std::vector<AppInterface*> DetachedLayers;
+    AppSettings Settings;
     std::unique_ptr<Window> Window;
     std::unique_ptr<Renderer> Renderer;
+    std::unique_ptr<AssetLoader> AssetLoader;
     EventDispatcher EventDispatcher;
+    /**
+     * \brief Fixed-timestep clock running the simulation systems, independently of the render rate.
+     */
+    SimulationClock SimulationClock;
+    /**
+     * \brief Scheduler of the long-running tasks, executed in slices within a time budget per frame.
+     */
+    TimeSlicedScheduler BackgroundScheduler;
+    /**
+     * \brief Suspended coroutines of the layers. Declared after the event dispatcher so it detaches its listeners before the dispatcher is destroyed.
+     */
+    CoroutineScheduler Coroutines;
     entt::registry SceneRegistry;
+    /**
+     * \brief Index of the named entities of the scene registry. Declared after the registry so it disconnects before the registry is destroyed.
+     */
+    NameIndex NameIndex;
+    /**
+     * \brief Mirror of the renderable entities of the scene registry, flushed into the frame data every frame. Declared after the registry so it disconnects before the registry is destroyed.
+     */
+    RenderExtractor RenderExtractor;
+    /**
+     * \brief Per-thread buckets of the draw commands recorded during the simulation, merged into the frame data.
+     */
+    std::unique_ptr<RenderCommandQueue> RenderCommands;
+    /**
+     * \brief Timings of the simulation and render stages of the main loop.
+     */
+    FrameStatistics FrameStatistics;
+    /**
+     * \brief Work-stealing job system shared by the engine and the layers. Declared last so its workers are joined before anything else is destroyed.
+     */
+    std::unique_ptr<JobSystem> JobSystem;
   };
 }
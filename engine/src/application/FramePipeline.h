@@ -0,0 +1,208 @@
+/**
+ * @file FramePipeline.h
+ * @brief Hand-off of the frame data between the simulation thread and the render thread.
+ */
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../graphics/FrameData.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Timings of the frames, in milliseconds, smoothed over the last frames.
+   */
+  struct FrameTimings {
+    double SimulationMs = 0.0;
+    double RenderMs = 0.0;
+    /**
+     * \brief Time between the start of the simulation of a frame and the end of its buffer swap.
+     */
+    double LatencyMs = 0.0;
+    /**
+     * \brief Time between two buffer swaps.
+     */
+    double FrameMs = 0.0;
+  };
+
+
+  /**
+   * @class FrameStatistics
+   * @brief Thread-safe accumulator of the frame timings, written by both the simulation and the render threads.
+   */
+  class FrameStatistics {
+  public:
+    /**
+     * \brief Weight of the last frame in the smoothed timings.
+     */
+    static constexpr double Smoothing = 0.1;
+
+    /**
+     * \brief Records the time spent by the simulation on a frame.
+     * \param milliseconds The simulation time.
+     */
+    void RecordSimulation(double milliseconds) {
+      std::lock_guard lock(mutex);
+      Smooth(timings.SimulationMs, milliseconds);
+    }
+
+
+    /**
+     * \brief Records the time spent by the renderer on a frame, once its buffers are swapped.
+     * \param frame The rendered frame.
+     * \param milliseconds The render time.
+     * \param stats The state changes of the frame.
+     */
+    void RecordRender(const FrameData& frame, double milliseconds, const RenderStats& stats) {
+      const auto now = std::chrono::steady_clock::now();
+      std::lock_guard lock(mutex);
+      renderStats = stats;
+      Smooth(timings.RenderMs, milliseconds);
+      Smooth(timings.LatencyMs, std::chrono::duration<double, std::milli>(now - frame.SimulationStart).count());
+      if (lastSwap != std::chrono::steady_clock::time_point()) {
+        Smooth(timings.FrameMs, std::chrono::duration<double, std::milli>(now - lastSwap).count());
+      }
+      lastSwap = now;
+    }
+
+
+    /**
+     * \brief Gets the smoothed timings.
+     * \return A copy of the timings.
+     */
+    [[nodiscard]] FrameTimings Get() const {
+      std::lock_guard lock(mutex);
+      return timings;
+    }
+
+
+    /**
+     * \brief Gets the state changes of the last rendered frame.
+     * \return A copy of the render statistics.
+     */
+    [[nodiscard]] RenderStats GetRenderStats() const {
+      std::lock_guard lock(mutex);
+      return renderStats;
+    }
+
+  private:
+    static void Smooth(double& value, double sample) {
+      value = value == 0.0 ? sample : value + (sample - value) * Smoothing;
+    }
+
+  private:
+    mutable std::mutex mutex;
+    FrameTimings timings;
+    RenderStats renderStats;
+    std::chrono::steady_clock::time_point lastSwap;
+  };
+
+
+  /**
+   * @class FramePipeline
+   * @brief Pool of FrameLatency + 1 frame data buffers cycling between the simulation thread and the render thread.
+   * @details
+   * The simulation acquires a free buffer, fills it and publishes it. The renderer acquires the oldest published buffer
+   * and releases it once drawn. The simulation blocks when every buffer is in use, so it never runs more than
+   * FrameLatency frames ahead of the renderer.
+   */
+  class FramePipeline {
+  public:
+    /**
+     * \brief Constructor for the FramePipeline class.
+     * \param latency The number of frames the simulation can run ahead of the renderer.
+     */
+    explicit FramePipeline(uint32_t latency) {
+      frames.resize(std::max(latency, 1u) + 1u);
+      for (auto& frame : frames) {
+        frame = std::make_unique<FrameData>();
+        free.push_back(frame.get());
+      }
+    }
+
+
+    /**
+     * \brief Gets a buffer for the simulation to fill, waiting for the renderer to release one if needed.
+     * \return The buffer, or nullptr if the pipeline was closed.
+     */
+    FrameData* AcquireSimulation() {
+      std::unique_lock lock(mutex);
+      condition.wait(lock, [this] { return closed || !free.empty(); });
+      if (closed) {
+        return nullptr;
+      }
+      FrameData* frame = free.front();
+      free.pop_front();
+      return frame;
+    }
+
+
+    /**
+     * \brief Hands a filled buffer to the renderer. The simulation must not touch it anymore.
+     * \param frame The buffer returned by AcquireSimulation().
+     */
+    void Publish(FrameData* frame) {
+      {
+        std::lock_guard lock(mutex);
+        ready.push_back(frame);
+      }
+      condition.notify_all();
+    }
+
+
+    /**
+     * \brief Gets the oldest published buffer, waiting for the simulation if needed.
+     * \return The buffer, or nullptr once the pipeline is closed and every published buffer was rendered.
+     */
+    FrameData* AcquireRender() {
+      std::unique_lock lock(mutex);
+      condition.wait(lock, [this] { return closed || !ready.empty(); });
+      if (ready.empty()) {
+        return nullptr;
+      }
+      FrameData* frame = ready.front();
+      ready.pop_front();
+      return frame;
+    }
+
+
+    /**
+     * \brief Gives a buffer back to the pool, once rendered or if the simulation gives up on it.
+     * \param frame The buffer returned by AcquireRender() or AcquireSimulation().
+     */
+    void Release(FrameData* frame) {
+      {
+        std::lock_guard lock(mutex);
+        free.push_back(frame);
+      }
+      condition.notify_all();
+    }
+
+
+    /**
+     * \brief Stops the pipeline. The renderer still drains the published buffers.
+     */
+    void Close() {
+      {
+        std::lock_guard lock(mutex);
+        closed = true;
+      }
+      condition.notify_all();
+    }
+
+  private:
+    std::vector<std::unique_ptr<FrameData>> frames;
+    std::deque<FrameData*> free;
+    std::deque<FrameData*> ready;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool closed = false;
+  };
+}
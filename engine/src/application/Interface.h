@@ -26,13 +26,11 @@ namespace HeimskrEngine {
     Layer* GetLayer() {
       static_assert(std::is_base_of_v<AppInterface, Layer>, "The Layer type needs to inherit from the AppInterface class.");
 
-      auto iterator = std::find_if(context->Layers.begin(), context->Layers.end(), [&](AppInterface* layer) {
-        return layer->id == TypeID<Layer>();
-      });
-      if (iterator == context->Layers.end()) {
+      const uint32_t index = TypeIndex<AppInterface>::Get<Layer>();
+      if (index >= context->LayerIndex.size()) {
         return nullptr;
       }
-      return static_cast<Layer*>(*iterator);
+      return static_cast<Layer*>(context->LayerIndex[index]);
     }
 
 
@@ -53,7 +51,13 @@ namespace HeimskrEngine {
 
       Layer* layer = new Layer(std::forward<Args>(args)...);
       context->Layers.push_back(layer);
+      const uint32_t index = TypeIndex<AppInterface>::Get<Layer>();
+      if (index >= context->LayerIndex.size()) {
+        context->LayerIndex.resize(TypeIndex<AppInterface>::Count(), nullptr);
+      }
+      context->LayerIndex[index] = layer;
       layer->id = TypeID<Layer>();
+      context->EventDispatcher.SetListenerName(layer->id, TypeName<Layer>());
       layer->context = context;
       layer->OnStart();
       return layer;
@@ -62,7 +66,7 @@ namespace HeimskrEngine {
 
     /**
      * \brief Start a task that detaches a layer from the context if found.
-     * \details Since we cannot simply remove a layer from the context while iterating through the layers, we need to post a task to the event queue to remove the layer while it is not in use.
+     * \details Since we cannot simply remove a layer from the context while iterating through the layers, we need to post a task to the event queue to remove the layer while it is not in use. The layer is deleted on the thread owning the GL context once the frames drawing it are rendered, so its destructor must only release its own resources.
      * \tparam Layer The layer to detach from the context. Must inherit from the AppInterface class.
      */
     template<typename Layer>
@@ -70,13 +74,16 @@ namespace HeimskrEngine {
       static_assert(std::is_base_of_v<AppInterface, Layer>, "The Layer type needs to inherit from the AppInterface class.");
 
       context->EventDispatcher.PostTask([this] {
+        const uint32_t index = TypeIndex<AppInterface>::Get<Layer>();
+        if (index < context->LayerIndex.size()) {
+          context->LayerIndex[index] = nullptr;
+        }
+        // The render thread might still be drawing the layer in the previous frames, so it deletes the layer once they are rendered.
         context->Layers.erase(std::remove_if(context->Layers.begin(), context->Layers.end(), [this](auto& layer) {
           if (layer->id == TypeID<Layer>()) {
             context->EventDispatcher.EraseListener(layer->id);
-            if (layer != nullptr) {
-              delete layer;
-              layer = nullptr;
-            }
+            context->Coroutines.Destroy(layer->id);
+            context->DetachedLayers.push_back(layer);
             return true;
           }
           return false;
@@ -90,10 +97,12 @@ namespace HeimskrEngine {
      * \tparam Event The event type to attach the callback to. Must inherit from the Event class.
      * \tparam Callback The callback function type. Must be callable with the event type as the first argument.
      * \param callback The callback function to attach to the event dispatcher.
+     * \param priority The priority of the callback, callbacks of higher priority being called first.
+     * \return The handle used to detach this callback alone.
      */
     template<typename Event, typename Callback>
-    void AttachCallback(Callback&& callback) {
-      context->EventDispatcher.AttachListener<Event>(std::move(callback), id);
+    ListenerHandle AttachCallback(Callback&& callback, int32_t priority = 0) {
+      return context->EventDispatcher.AttachListener<Event>(std::move(callback), id, priority);
     }
 
 
@@ -109,6 +118,18 @@ namespace HeimskrEngine {
     }
 
 
+    /**
+     * \brief Deliver an event to its listeners right away, instead of on the next poll.
+     * \tparam Event The event type to dispatch.
+     * \tparam Args The arguments type to pass to the event constructor.
+     * \param args The arguments to pass to the event constructor.
+     */
+    template <typename Event, typename ... Args>
+    void DispatchEvent(Args&& ... args) {
+      context->EventDispatcher.Dispatch<Event>(std::forward<Args>(args)...);
+    }
+
+
     /**
      * \brief Post a task to the event dispatcher.
      * \tparam Task The task type to post. Must be callable.
@@ -120,6 +141,55 @@ namespace HeimskrEngine {
     }
 
 
+    /**
+     * \brief Post a task running once after a delay (see EventDispatcher::PostDelayedTask()).
+     * \tparam Task The task type to post. Must be callable.
+     * \param delay The delay before running the task.
+     * \param task The task to post to the event dispatcher.
+     * \return The handle used to cancel the task.
+     */
+    template<typename Task>
+    TaskHandle PostDelayedTask(std::chrono::milliseconds delay, Task&& task) {
+      return context->EventDispatcher.PostDelayedTask(delay, std::forward<Task>(task));
+    }
+
+
+    /**
+     * \brief Post a task running periodically until cancelled (see EventDispatcher::PostRepeatingTask()).
+     * \tparam Task The task type to post. Must be callable.
+     * \param period The time between two runs of the task.
+     * \param task The task to post to the event dispatcher.
+     * \return The handle used to cancel the task.
+     */
+    template<typename Task>
+    TaskHandle PostRepeatingTask(std::chrono::milliseconds period, Task&& task) {
+      return context->EventDispatcher.PostRepeatingTask(period, std::forward<Task>(task));
+    }
+
+
+    /**
+     * \brief Post a task running once after a number of frames (see EventDispatcher::PostFrameTask()).
+     * \tparam Task The task type to post. Must be callable.
+     * \param frames The number of frames to wait.
+     * \param task The task to post to the event dispatcher.
+     * \return The handle used to cancel the task.
+     */
+    template<typename Task>
+    TaskHandle PostFrameTask(uint32_t frames, Task&& task) {
+      return context->EventDispatcher.PostFrameTask(frames, std::forward<Task>(task));
+    }
+
+
+    /**
+     * \brief Cancel a delayed, repeating or frame task.
+     * \param handle The handle returned when the task was posted.
+     * \return True if the task was pending.
+     */
+    bool CancelTask(TaskHandle handle) {
+      return context->EventDispatcher.CancelTask(handle);
+    }
+
+
     /**
      * \brief Detach a callback function from the event dispatcher.
      * \tparam Event The event type to detach the callback from. Must inherit from the Event class.
@@ -130,6 +200,149 @@ namespace HeimskrEngine {
     }
 
 
+    /**
+     * \brief Detach a single callback from the event dispatcher.
+     * \param handle The handle returned by AttachCallback().
+     */
+    void DetachCallback(ListenerHandle handle) const {
+      context->EventDispatcher.DetachListener(handle);
+    }
+
+
+    /**
+     * \brief Gets the job system of the context, used to run work in parallel (see JobSystem::ParallelFor).
+     * \return The job system.
+     */
+    JobSystem& GetJobSystem() const {
+      return *context->JobSystem;
+    }
+
+
+    /**
+     * \brief Records a draw for the current frame, with its own model matrix. Can be called from the jobs of the job system.
+     * \details The command is merged and executed on the GL thread with the commands of the mesh entities.
+     * \param mesh The mesh to draw.
+     * \param model The model matrix of the draw.
+     * \param material The material of the draw.
+     * \param pass The pass of the draw, transparent draws being sorted back to front.
+     */
+    void SubmitDraw(const Mesh3D& mesh, const glm::mat4& model, uint32_t material = 0u, RenderPass pass = RenderPass::Opaque) const {
+      context->RenderCommands->Submit(mesh, model, material, pass);
+    }
+
+
+    /**
+     * \brief Registers a simulation system ticking at its own fixed rate, independently of the render rate.
+     * \param rate The number of ticks per second (e.g. 1000 for a physics step, 10 for an AI update).
+     * \param function The function called on every tick with the fixed step in seconds.
+     * \return The identifier of the system, used to remove it.
+     */
+    uint32_t AddFixedSystem(double rate, SimulationClock::SystemFunction function) const {
+      return context->SimulationClock.AddSystem(rate, std::move(function));
+    }
+
+
+    /**
+     * \brief Removes a simulation system registered through AddFixedSystem().
+     * \param system The identifier of the system.
+     */
+    void RemoveFixedSystem(uint32_t system) const {
+      context->SimulationClock.RemoveSystem(system);
+    }
+
+
+    /**
+     * \brief Schedules a long-running task executed in slices on the simulation thread, within a time budget per frame.
+     * \details The function is called once per frame until it returns true. It must return when TimeSlice::Expired() becomes true, keeping its state in its captures to resume on the next frame.
+     * \param name The name of the task.
+     * \param function The function called on every slice.
+     * \param priority The priority of the task, higher priorities running first.
+     * \return The handle used to follow the progress of the task or to cancel it.
+     */
+    SlicedTaskHandle ScheduleSliced(std::string name, TimeSlicedScheduler::TaskFunction function, int32_t priority = 0) const {
+      return context->BackgroundScheduler.Schedule(std::move(name), std::move(function), priority);
+    }
+
+
+    /**
+     * \brief Suspends the calling coroutine until the next frame, as in co_await NextFrame().
+     * \return The awaitable.
+     */
+    NextFrameAwaiter NextFrame() const {
+      return { &context->Coroutines, id };
+    }
+
+
+    /**
+     * \brief Suspends the calling coroutine for a duration of simulation time, as in co_await Seconds(2.0).
+     * \param seconds The duration in seconds.
+     * \return The awaitable.
+     */
+    SecondsAwaiter Seconds(double seconds) const {
+      return { &context->Coroutines, seconds, id };
+    }
+
+
+    /**
+     * \brief Suspends the calling coroutine until an event is dispatched, as in auto key = co_await WaitEvent<KeyPressEvent>().
+     * \tparam Event The event type to wait for.
+     * \return The awaitable, resuming with a copy of the event.
+     */
+    template<typename Event>
+    EventAwaiter<Event> WaitEvent() const {
+      return EventAwaiter<Event>(&context->Coroutines, id);
+    }
+
+
+    /**
+     * \brief Suspends the calling coroutine until a model is loaded, as in auto model = co_await WaitAsset(LoadModel(path)).
+     * \param model The model being loaded.
+     * \return The awaitable, resuming with the model, which is either ready or failed.
+     */
+    AssetAwaiter WaitAsset(ModelHandle model) const {
+      return AssetAwaiter(&context->Coroutines, std::move(model), id);
+    }
+
+
+    /**
+     * \brief Starts loading a model in the background.
+     * \details An AssetLoadedEvent is posted once the model is ready to be drawn, or failed to load. The handle can be dropped from the simulation thread, its meshes being destroyed later on the GL thread.
+     * \param path The path of the model file.
+     * \return The handle of the model, whose meshes are available once it is ready.
+     */
+    ModelHandle LoadModel(const std::string& path) const {
+      return context->AssetLoader->LoadModel(path);
+    }
+
+
+    /**
+     * \brief Gets the smoothed timings of the main loop, including the latency added by pipelined rendering.
+     * \return The frame timings.
+     */
+    FrameTimings GetFrameTimings() const {
+      return context->FrameStatistics.Get();
+    }
+
+
+    /**
+     * \brief Gets the draws and GL state changes of the last rendered frame, to check how well the sorted draws share their state and how many mesh entities were culled.
+     * \return The render statistics.
+     */
+    RenderStats GetRenderStats() const {
+      return context->FrameStatistics.GetRenderStats();
+    }
+
+
+    /**
+     * \brief Gets the time spent in the event callbacks, per event type and layer, to find which layer causes a frame spike.
+     * \details The callbacks are only measured in builds with HEIMSKR_ENGINE_PROFILE_EVENTS, once enabled with EventDispatcher::SetProfiling().
+     * \return One profile per event type and listener.
+     */
+    std::vector<ListenerProfile> GetListenerProfiles() const {
+      return context->EventDispatcher.GetProfiles();
+    }
+
+
     /**
      * \brief Creates a new entity of the specified type.
      * \tparam Entt The entity type to create. Must inherit from the Entity class.
@@ -157,6 +370,74 @@ namespace HeimskrEngine {
     }
 
 
+    /**
+     * \brief Finds the first entity with the specified name through the name index, without scanning the registry.
+     * \tparam Entt The entity type to return. Must inherit from the Entity class.
+     * \param name The name of the entity (see EnttComponent).
+     * \return The entity object, which converts to false if no entity has this name.
+     */
+    template<typename Entt>
+    Entt FindEntity(std::string_view name) {
+      static_assert(std::is_base_of_v<Entity, Entt>);
+      return std::move(Entt(&context->SceneRegistry, context->NameIndex.Find(name)));
+    }
+
+
+    /**
+     * \brief Finds the mesh entity whose world box is hit first by a ray, e.g. for the picking of the editor.
+     * \details Goes through the hierarchy of the rendered instances, whose boxes are those of the last rendered frame.
+     * \tparam Entt The entity type to return. Must inherit from the Entity class.
+     * \param origin The origin of the ray in world space.
+     * \param direction The direction of the ray, the distances being measured in its length.
+     * \param maxDistance The distance beyond which the boxes are ignored.
+     * \return The entity object, which converts to false if no box is hit.
+     */
+    template<typename Entt>
+    Entt PickEntity(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = FLT_MAX) {
+      static_assert(std::is_base_of_v<Entity, Entt>);
+      RayHit hit;
+      const auto& extractor = context->RenderExtractor;
+      const entt::entity entity = extractor.GetHierarchy().Raycast(origin, direction, maxDistance, hit) ? extractor.GetEntity(hit.Id) : entt::null;
+      return std::move(Entt(&context->SceneRegistry, entity));
+    }
+
+
+    /**
+     * \brief Executes a task for every mesh entity whose world box intersects a sphere, without scanning the registry.
+     * \details The task must not add or remove meshes, the query going through the hierarchy they are stored in.
+     * \tparam Entt The entity type to iterate over. Must inherit from the Entity class.
+     * \tparam Task The task type to execute. Must be callable with the entity as argument.
+     * \param sphere The sphere in world space.
+     * \param task The task to execute for each entity.
+     */
+    template<typename Entt, typename Task>
+    void EntitiesInSphere(const BoundingSphere& sphere, Task&& task) {
+      static_assert(std::is_base_of_v<Entity, Entt>);
+      const auto& extractor = context->RenderExtractor;
+      extractor.GetHierarchy().QuerySphere(sphere, [&](uint32_t slot) {
+        task(Entt(&context->SceneRegistry, extractor.GetEntity(slot)));
+      });
+    }
+
+
+    /**
+     * \brief Executes a task for every mesh entity whose world box intersects a box, without scanning the registry.
+     * \details The task must not add or remove meshes, the query going through the hierarchy they are stored in.
+     * \tparam Entt The entity type to iterate over. Must inherit from the Entity class.
+     * \tparam Task The task type to execute. Must be callable with the entity as argument.
+     * \param box The box in world space.
+     * \param task The task to execute for each entity.
+     */
+    template<typename Entt, typename Task>
+    void EntitiesInBox(const BoundingBox& box, Task&& task) {
+      static_assert(std::is_base_of_v<Entity, Entt>);
+      const auto& extractor = context->RenderExtractor;
+      extractor.GetHierarchy().QueryBox(box, [&](uint32_t slot) {
+        task(Entt(&context->SceneRegistry, extractor.GetEntity(slot)));
+      });
+    }
+
+
     /**
      * \brief Iterates over all entities that possess the specified component and executes the given task for each entity and its component.
      * \tparam Entt The entity type to iterate over. Must inherit from the Entity class.
@@ -167,13 +448,23 @@ namespace HeimskrEngine {
     template<typename Entt, typename Component, typename Task>
     void EntityView(Task&& task) {
       static_assert(std::is_base_of_v<Entity, Entt>);
-      context->SceneRegistry.view<Component>().each([this, &task](auto entity, auto& component) {
+      // The tracked components are read-only here, their changes going through Entity::Patch().
+      context->SceneRegistry.view<ComponentAccess<Component>>().each([this, &task](auto entity, auto& component) {
         task(std::move(Entt(&context->SceneRegistry, entity)), component);
       });
     }
 
   protected:
     virtual void OnUpdate() {}
+    /**
+     * \brief Called at the fixed rate of AppSettings::FixedUpdateRate, zero or more times per frame, before OnUpdate().
+     * \param step The fixed step in seconds.
+     */
+    virtual void OnFixedUpdate([[maybe_unused]] double step) {}
+    /**
+     * \brief Called on the thread owning the GL context after the scene is rendered, before the frame is shown. Every OpenGL call of a layer belongs here. With pipelined rendering, it runs on the render thread at the same time as OnUpdate() of the next frame.
+     */
+    virtual void OnRender() {}
     virtual void OnStart() {}
 
   private:
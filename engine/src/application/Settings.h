@@ -0,0 +1,68 @@
+/**
+ * @file Settings.h
+ * @brief Settings given to the application when it is created.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Configuration of the application main loop.
+   */
+  struct AppSettings {
+    /**
+     * \brief Runs the renderer on a dedicated thread owning the GL context, while the simulation builds the next frame.
+     * \details The frame time becomes the maximum of the simulation and render times instead of their sum, at the cost of FrameLatency additional frames between the simulation and the display. Layers must not call OpenGL from OnUpdate() in this mode, only from OnRender().
+     */
+    bool PipelinedRendering = false;
+
+    /**
+     * \brief Number of frames the simulation can run ahead of the renderer in pipelined mode. Must be at least 1.
+     */
+    uint32_t FrameLatency = 1u;
+
+    /**
+     * \brief Rate of the fixed updates of the layers (see AppInterface::OnFixedUpdate()), in ticks per second.
+     * \details The interpolated transforms are blended between two of these ticks. Systems needing another rate are registered through AppInterface::AddFixedSystem().
+     */
+    double FixedUpdateRate = 60.0;
+
+    /**
+     * \brief Frame duration the engine tries to stay under, in milliseconds, used to measure the headroom of the frames.
+     */
+    double TargetFrameMs = 1000.0 / 60.0;
+
+    /**
+     * \brief Initial time given per frame to the background tasks (see AppInterface::ScheduleSliced()), adapted afterwards to the headroom of the frames.
+     */
+    double BackgroundBudgetMs = 2.0;
+
+    /**
+     * \brief Synchronizes the buffer swaps with the monitor refresh rate. The simulation rate does not depend on it.
+     */
+    bool VSync = true;
+
+    /**
+     * \brief Number of threads reading and decoding the assets requested through the AssetLoader.
+     */
+    uint32_t AssetThreads = 1u;
+
+    /**
+     * \brief Maximum number of bytes of asset data uploaded to the GPU per frame, bounding the time the loads take from the frame.
+     */
+    size_t AssetUploadBudget = 4u * 1024u * 1024u;
+
+    /**
+     * \brief File the window input and the other recordable events are recorded to, with their frame numbers. Nothing is recorded if empty.
+     */
+    std::string RecordEventsPath;
+
+    /**
+     * \brief Recording replayed from the first frame instead of the live window input, for reproducible performance runs. Ignored if empty.
+     */
+    std::string ReplayEventsPath;
+  };
+}
@@ -0,0 +1,272 @@
+/**
+ * @file AssetLoader.cpp
+ * @brief Implementation of the AssetLoader class.
+ */
+
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "../graphics/AssimpHelper.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Queues meshes for their destruction on the GL thread.
+   * \param dropped The meshes, moved into the queue.
+   */
+  void MeshReleaseQueue::Push(std::vector<Mesh3D>&& dropped) {
+    std::lock_guard lock(mutex);
+    std::move(dropped.begin(), dropped.end(), std::back_inserter(meshes));
+    dropped.clear();
+  }
+
+
+  /**
+   * \brief Drops the queued meshes. Must be called from the thread owning the GL context.
+   * \details The meshes still referenced elsewhere, e.g. by a mesh entity, are only destroyed with their last reference.
+   */
+  void MeshReleaseQueue::Release() {
+    std::vector<Mesh3D> released;
+    {
+      std::lock_guard lock(mutex);
+      released.swap(meshes);
+    }
+  }
+
+
+  /**
+   * \brief Destructor for the ModelAsset class. Hands the meshes to the release queue, as the last handle might be dropped by a thread without the GL context.
+   */
+  ModelAsset::~ModelAsset() {
+    if (releases != nullptr && !meshes.empty()) {
+      releases->Push(std::move(meshes));
+    }
+  }
+
+
+  /**
+   * \brief Constructor for the AssetLoader class.
+   * \param threadCount The number of loader threads.
+   */
+  AssetLoader::AssetLoader(uint32_t threadCount) {
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t index = 0u; index < threadCount; ++index) {
+      threads.emplace_back(&AssetLoader::LoaderLoop, this);
+    }
+  }
+
+
+  /**
+   * \brief Destructor for the AssetLoader class. Waits for the files being decoded, the queued requests are dropped.
+   * \details Must be called with the GL context current, as it releases the meshes of the dropped models.
+   */
+  AssetLoader::~AssetLoader() {
+    {
+      std::lock_guard lock(requestMutex);
+      running = false;
+    }
+    requestCondition.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    releases->Release();
+  }
+
+
+  /**
+   * \brief Requests the loading of a model file.
+   * \param path The path of the model, in any format supported by Assimp.
+   * \return The handle of the model, returned immediately while the model is loading.
+   */
+  ModelHandle AssetLoader::LoadModel(const std::string& path) {
+    auto model = std::make_shared<ModelAsset>(path, releases);
+    {
+      std::lock_guard lock(requestMutex);
+      requests.push_back(model);
+    }
+    requestCondition.notify_one();
+    return model;
+  }
+
+
+  /**
+   * \brief Uploads the decoded models to the GPU and releases the dropped ones. Must be called once per frame from the thread owning the GL context.
+   * \param budget The maximum number of bytes to upload during this call.
+   */
+  void AssetLoader::Upload(size_t budget) {
+    releases->Release();
+    while (budget > 0u) {
+      if (current == nullptr) {
+        std::lock_guard lock(uploadMutex);
+        if (uploads.empty()) {
+          return;
+        }
+        current = std::move(uploads.front());
+        uploads.pop_front();
+      }
+
+      if (!UploadSlice(*current, budget)) {
+        return;
+      }
+
+      current->staging = {};
+      current->state.store(AssetState::Ready, std::memory_order_release);
+      {
+        std::lock_guard lock(completedMutex);
+        completed.push_back(std::move(current));
+      }
+      current = nullptr;
+    }
+  }
+
+
+  /**
+   * \brief Posts an AssetLoadedEvent for every model completed since the last call. Must be called from the thread polling the dispatcher.
+   * \param dispatcher The event dispatcher of the application.
+   */
+  void AssetLoader::Dispatch(EventDispatcher& dispatcher) {
+    std::vector<ModelHandle> models;
+    {
+      std::lock_guard lock(completedMutex);
+      models.swap(completed);
+    }
+    for (auto& model : models) {
+      dispatcher.PostEvent<AssetLoadedEvent>(std::move(model));
+    }
+  }
+
+
+  /**
+   * \brief Loop of the loader threads, decoding the requested models one at a time.
+   */
+  void AssetLoader::LoaderLoop() {
+    for (;;) {
+      ModelHandle model;
+      {
+        std::unique_lock lock(requestMutex);
+        requestCondition.wait(lock, [this] { return !running || !requests.empty(); });
+        if (!running) {
+          return;
+        }
+        model = std::move(requests.front());
+        requests.pop_front();
+      }
+
+      if (!Decode(*model)) {
+        model->state.store(AssetState::Failed, std::memory_order_release);
+        std::lock_guard lock(completedMutex);
+        completed.push_back(std::move(model));
+        continue;
+      }
+
+      model->state.store(AssetState::Uploading, std::memory_order_release);
+      std::lock_guard lock(uploadMutex);
+      uploads.push_back(std::move(model));
+    }
+  }
+
+
+  /**
+   * \brief Reads a model file and converts its meshes to the engine vertex format.
+   * \details The node transforms are baked into the vertices, so the meshes are expressed in the model space.
+   * \param model The model to decode.
+   * \return True if the model was decoded, false otherwise.
+   */
+  bool AssetLoader::Decode(ModelAsset& model) {
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(model.path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_PreTransformVertices);
+    if (scene == nullptr || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0u) {
+      HEIMSKR_ERROR(fmt::format("Failed to load model {}: {}", model.path, importer.GetErrorString()));
+      return false;
+    }
+
+    model.staging.reserve(scene->mNumMeshes);
+    for (uint32_t meshIndex = 0u; meshIndex < scene->mNumMeshes; ++meshIndex) {
+      const aiMesh* mesh = scene->mMeshes[meshIndex];
+      if (mesh->mNumVertices == 0u) {
+        continue;
+      }
+
+      MeshData<ShadedVertex>& data = model.staging.emplace_back();
+      data.Vertices.resize(mesh->mNumVertices);
+      for (uint32_t vertex = 0u; vertex < mesh->mNumVertices; ++vertex) {
+        data.Vertices[vertex].Position = ToGLM(mesh->mVertices[vertex]);
+        if (mesh->HasNormals()) {
+          data.Vertices[vertex].Normal = ToGLM(mesh->mNormals[vertex]);
+        }
+        if (mesh->HasTextureCoords(0)) {
+          data.Vertices[vertex].UVs = glm::vec2(mesh->mTextureCoords[0][vertex].x, mesh->mTextureCoords[0][vertex].y);
+        }
+      }
+
+      data.Indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3u);
+      for (uint32_t face = 0u; face < mesh->mNumFaces; ++face) {
+        const aiFace& indices = mesh->mFaces[face];
+        // Points and lines left by the triangulation are not drawn by the PBR shader.
+        if (indices.mNumIndices != 3u) {
+          continue;
+        }
+        data.Indices.insert(data.Indices.end(), indices.mIndices, indices.mIndices + 3);
+      }
+      // Without indices the mesh would be drawn as sequential triangles, turning its points or lines into garbage.
+      if (data.Indices.empty()) {
+        model.staging.pop_back();
+      }
+    }
+    return true;
+  }
+
+
+  /**
+   * \brief Uploads the next part of a model, within the budget.
+   * \param model The model being uploaded.
+   * \param budget The remaining number of bytes to upload this frame, decreased by what was uploaded.
+   * \return True once every mesh of the model is uploaded.
+   */
+  bool AssetLoader::UploadSlice(ModelAsset& model, size_t& budget) {
+    while (model.stagingIndex < model.staging.size()) {
+      if (budget == 0u) {
+        return false;
+      }
+
+      MeshData<ShadedVertex>& data = model.staging[model.stagingIndex];
+      const auto vertexCount = static_cast<uint32_t>(data.Vertices.size());
+      const auto indexCount = static_cast<uint32_t>(data.Indices.size());
+      if (model.meshes.size() == model.stagingIndex) {
+        auto mesh = std::make_shared<ShadedMesh>(vertexCount, indexCount);
+        mesh->SetBounds(MeshBounds::FromVertices(data.Vertices));
+        model.meshes.push_back(std::move(mesh));
+      }
+      const ShadedMesh& mesh = *model.meshes.back();
+
+      if (model.vertexOffset < vertexCount) {
+        const auto count = static_cast<uint32_t>(std::clamp<size_t>(budget / sizeof(ShadedVertex), 1u, vertexCount - model.vertexOffset));
+        mesh.UploadVertices(model.vertexOffset, data.Vertices.data() + model.vertexOffset, count);
+        model.vertexOffset += count;
+        budget -= std::min(budget, count * sizeof(ShadedVertex));
+        continue;
+      }
+
+      if (model.indexOffset < indexCount) {
+        const auto count = static_cast<uint32_t>(std::clamp<size_t>(budget / sizeof(uint32_t), 1u, indexCount - model.indexOffset));
+        mesh.UploadIndices(model.indexOffset, data.Indices.data() + model.indexOffset, count);
+        model.indexOffset += count;
+        budget -= std::min(budget, count * sizeof(uint32_t));
+        continue;
+      }
+
+      // The mesh is on the GPU, so its CPU copy is released right away.
+      data = {};
+      model.stagingIndex++;
+      model.vertexOffset = 0u;
+      model.indexOffset = 0u;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file AssetLoader.h
+ * @brief Asynchronous asset loader decoding files on background threads and uploading them to the GPU in slices.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../common/Event.h"
+#include "../graphics/buffers/Mesh.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Loading steps of an asset.
+   */
+  enum class AssetState : uint8_t {
+    Loading,
+    Uploading,
+    Ready,
+    Failed
+  };
+
+
+  /**
+   * @class MeshReleaseQueue
+   * @brief Meshes dropped by any thread, destroyed later by the thread owning the GL context.
+   */
+  class MeshReleaseQueue {
+  public:
+    void Push(std::vector<Mesh3D>&& dropped);
+    void Release();
+
+  private:
+    std::mutex mutex;
+    std::vector<Mesh3D> meshes;
+  };
+
+
+  /**
+   * @class ModelAsset
+   * @brief Meshes of a model file, filled asynchronously by the AssetLoader.
+   * @details
+   * The meshes must only be accessed once the state is AssetState::Ready. The handle can be dropped from any thread:
+   * its meshes are then handed to the release queue of the loader, so they are destroyed with the GL context current.
+   */
+  class ModelAsset {
+  public:
+    explicit ModelAsset(std::string path, std::shared_ptr<MeshReleaseQueue> releases = nullptr) : path(std::move(path)), releases(std::move(releases)) {}
+    ~ModelAsset();
+
+    ModelAsset(const ModelAsset&) = delete;
+    ModelAsset& operator=(const ModelAsset&) = delete;
+
+    [[nodiscard]] const std::string& GetPath() const { return path; }
+    [[nodiscard]] AssetState GetState() const { return state.load(std::memory_order_acquire); }
+    [[nodiscard]] bool IsReady() const { return GetState() == AssetState::Ready; }
+    [[nodiscard]] const std::vector<Mesh3D>& GetMeshes() const { return meshes; }
+
+  private:
+    friend class AssetLoader;
+    std::string path;
+    std::atomic<AssetState> state = AssetState::Loading;
+    std::vector<Mesh3D> meshes;
+    std::shared_ptr<MeshReleaseQueue> releases;
+    // Decoded meshes waiting for their upload, released as soon as they are on the GPU.
+    std::vector<MeshData<ShadedVertex>> staging;
+    size_t stagingIndex = 0u;
+    uint32_t vertexOffset = 0u;
+    uint32_t indexOffset = 0u;
+  };
+
+  using ModelHandle = std::shared_ptr<ModelAsset>;
+
+
+  /**
+   * \brief Event posted once a model is ready to be drawn, or failed to load.
+   */
+  struct AssetLoadedEvent {
+    AssetLoadedEvent(ModelHandle model) : Model(std::move(model)) {  }
+    ModelHandle Model;
+  };
+
+
+  /**
+   * @class AssetLoader
+   * @brief Loads models without stalling the frame.
+   * @details
+   * Files are read and decoded by dedicated loader threads, not by the job system, since a single decode can take
+   * seconds and would otherwise be picked up by the main thread while it waits on a job counter. The decoded meshes are
+   * then uploaded by Upload(), called once per frame on the thread owning the GL context, which never uploads more than
+   * its byte budget. Completed assets are announced by Dispatch() through the event dispatcher of the main thread.
+   * Upload() also destroys the meshes of the models dropped since the last call, wherever they were dropped.
+   */
+  class AssetLoader {
+  public:
+    explicit AssetLoader(uint32_t threadCount = 1u);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    ModelHandle LoadModel(const std::string& path);
+    void Upload(size_t budget);
+    void Dispatch(EventDispatcher& dispatcher);
+
+  private:
+    void LoaderLoop();
+    static bool Decode(ModelAsset& model);
+    static bool UploadSlice(ModelAsset& model, size_t& budget);
+
+  private:
+    std::vector<std::thread> threads;
+    bool running = true;
+    std::mutex requestMutex;
+    std::condition_variable requestCondition;
+    std::deque<ModelHandle> requests;
+
+    // Decoded models, waiting for the GL thread.
+    std::mutex uploadMutex;
+    std::deque<ModelHandle> uploads;
+    // Only accessed from the GL thread.
+    ModelHandle current;
+
+    // Completed models, waiting for the main thread.
+    std::mutex completedMutex;
+    std::vector<ModelHandle> completed;
+
+    // Meshes of the dropped models, waiting for the GL thread. Shared with the models, which can outlive the loader.
+    std::shared_ptr<MeshReleaseQueue> releases = std::make_shared<MeshReleaseQueue>();
+  };
+}
@@ -0,0 +1,167 @@
+/**
+ * @file Delegate.h
+ * @brief Move-only callable wrapper storing small captures inline instead of on the heap.
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace HeimskrEngine {
+  template<typename Signature, size_t InlineSize = 48u>
+  class Delegate;
+
+  /**
+   * @class Delegate
+   * @brief Replacement of std::function for the callbacks of the engine (listeners, tasks, timers).
+   * @details
+   * Callables of up to InlineSize bytes (a lambda capturing a few pointers, a shared_ptr and a couple of values) are
+   * constructed inside the delegate itself, so creating, moving and destroying the delegate never allocates. Bigger
+   * callables fall back to the heap. The delegate is move-only, so it can hold move-only captures such as a
+   * unique_ptr, and it dispatches through a single table of function pointers per callable type.
+   * \tparam Result The return type of the signature.
+   * \tparam Args The argument types of the signature.
+   * \tparam InlineSize The size of the inline storage, in bytes.
+   */
+  template<typename Result, typename... Args, size_t InlineSize>
+  class Delegate<Result(Args...), InlineSize> {
+  public:
+    /**
+     * \brief Tells if a callable type is stored inline, without allocating.
+     * \tparam Function The type of the callable.
+     */
+    template<typename Function>
+    static constexpr bool StoresInline = sizeof(Function) <= InlineSize && alignof(Function) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Function>;
+
+    Delegate() = default;
+    Delegate(std::nullptr_t) {}
+
+    template<typename Function, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Function>, Delegate> && std::is_invocable_r_v<Result, std::decay_t<Function>&, Args...>>>
+    Delegate(Function&& function) {
+      using Stored = std::decay_t<Function>;
+      if constexpr (std::is_pointer_v<Stored> || std::is_member_pointer_v<Stored> || std::is_same_v<Stored, std::function<Result(Args...)>>) {
+        // Null function pointers and empty std::function give an empty delegate, as they would for std::function.
+        if (!function) {
+          return;
+        }
+      }
+      if constexpr (StoresInline<Stored>) {
+        new (&storage) Stored(std::forward<Function>(function));
+      } else {
+        *reinterpret_cast<Stored**>(&storage) = new Stored(std::forward<Function>(function));
+      }
+      table = &Table<Stored>::Value;
+    }
+
+    Delegate(Delegate&& other) noexcept {
+      MoveFrom(other);
+    }
+
+    Delegate& operator=(Delegate&& other) noexcept {
+      if (this != &other) {
+        Reset();
+        MoveFrom(other);
+      }
+      return *this;
+    }
+
+    Delegate& operator=(std::nullptr_t) {
+      Reset();
+      return *this;
+    }
+
+    ~Delegate() {
+      Reset();
+    }
+
+    Delegate(const Delegate&) = delete;
+    Delegate& operator=(const Delegate&) = delete;
+
+
+    /**
+     * \brief Calls the stored callable. The delegate must not be empty.
+     * \param args The arguments of the call.
+     * \return The result of the callable.
+     */
+    Result operator()(Args... args) const {
+      return table->Invoke(const_cast<Storage*>(&storage), std::forward<Args>(args)...);
+    }
+
+
+    /**
+     * \brief Destroys the stored callable, leaving the delegate empty.
+     */
+    void Reset() {
+      if (table != nullptr) {
+        table->Destroy(&storage);
+        table = nullptr;
+      }
+    }
+
+
+    explicit operator bool() const { return table != nullptr; }
+
+  private:
+    struct Storage {
+      alignas(std::max_align_t) std::byte Bytes[InlineSize < sizeof(void*) ? sizeof(void*) : InlineSize];
+    };
+
+    struct VTable {
+      Result (*Invoke)(Storage* storage, Args&&... args);
+      // Moves the callable to an uninitialized storage and destroys the source.
+      void (*Move)(Storage* destination, Storage* source);
+      void (*Destroy)(Storage* storage);
+    };
+
+    template<typename Stored>
+    struct Table {
+      static Stored* Get(Storage* storage) {
+        if constexpr (StoresInline<Stored>) {
+          return std::launder(reinterpret_cast<Stored*>(storage));
+        } else {
+          return *reinterpret_cast<Stored**>(storage);
+        }
+      }
+
+      static Result Invoke(Storage* storage, Args&&... args) {
+        return std::invoke(*Get(storage), std::forward<Args>(args)...);
+      }
+
+      static void Move(Storage* destination, Storage* source) {
+        if constexpr (StoresInline<Stored>) {
+          Stored* function = Get(source);
+          new (destination) Stored(std::move(*function));
+          std::destroy_at(function);
+        } else {
+          *reinterpret_cast<Stored**>(destination) = Get(source);
+        }
+      }
+
+      static void Destroy(Storage* storage) {
+        if constexpr (StoresInline<Stored>) {
+          std::destroy_at(Get(storage));
+        } else {
+          delete Get(storage);
+        }
+      }
+
+      static constexpr VTable Value = { &Invoke, &Move, &Destroy };
+    };
+
+    void MoveFrom(Delegate& other) {
+      if (other.table != nullptr) {
+        other.table->Move(&storage, &other.storage);
+        table = other.table;
+        other.table = nullptr;
+      }
+    }
+
+  private:
+    Storage storage;
+    const VTable* table = nullptr;
+  };
+}
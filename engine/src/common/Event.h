@@ -4,111 +4,591 @@
  */
 
 #pragma once
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
 #include <memory>
-#include <queue>
-#include <ranges>
+#include <new>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
+#include "Delegate.h"
+#include "EventRecorder.h"
+#include "MPSCQueue.h"
+#include "RingBuffer.h"
+#include "TimingWheel.h"
 #include "Types.h"
 
+// For profiling the listeners, define HEIMSKR_ENGINE_PROFILE_EVENTS in Project settings -> C/C++ -> Preprocessor -> Preprocessor definitions.
+
 namespace HeimskrEngine {
+  /**
+   * \brief How the events of a type posted between two polls are merged before their delivery.
+   */
+  enum class CoalescePolicy {
+    /**
+     * \brief Every event is delivered.
+     */
+    KeepAll,
+    /**
+     * \brief Only the last event is delivered, for states where the intermediate values do not matter (e.g. a window size).
+     */
+    KeepLast,
+    /**
+     * \brief The events are accumulated into a single one by EventCoalescing::Accumulate (e.g. mouse deltas).
+     */
+    SumDeltas
+  };
+
+
+  /**
+   * \brief Coalescing policy of an event type, specialized next to the events that need one.
+   * \details A SumDeltas specialization must also provide static void Accumulate(Event& total, const Event& event).
+   * \tparam Event The type of the event.
+   */
+  template<typename Event>
+  struct EventCoalescing {
+    static constexpr CoalescePolicy Policy = CoalescePolicy::KeepAll;
+  };
+
+
+  /**
+   * \brief Time spent in the callbacks of a listener for an event type, accumulated while the profiling is enabled.
+   * \details The time of a callback includes the listeners it dispatches to with EventDispatcher::Dispatch().
+   */
+  struct ListenerProfile {
+    /**
+     * \brief The name of the event type.
+     */
+    std::string_view Event;
+    /**
+     * \brief The name of the listener, given with EventDispatcher::SetListenerName(), or empty.
+     */
+    std::string_view Listener;
+    uint32_t ListenerId = 0u;
+    uint64_t Calls = 0u;
+    std::chrono::nanoseconds Total { 0 };
+    std::chrono::nanoseconds Max { 0 };
+
+    void Record(std::chrono::nanoseconds duration) {
+      Calls++;
+      Total += duration;
+      Max = std::max(Max, duration);
+    }
+  };
+
 
   template<typename Event>
   class EventListener {
-    using CallbackFunction = std::function<void(const Event&)>;
+    using CallbackFunction = Delegate<void(const Event&)>;
   public:
-    EventListener(CallbackFunction&& cb, uint32_t listenerId) : Callback(std::move(cb)), Id(listenerId) {}
+    EventListener() = default;
 
   public:
     CallbackFunction Callback;
-    uint32_t Id;
+    uint32_t Id = 0u;
+    int32_t Priority = 0;
+    // Links of the listener list of the channel, ordered by decreasing priority.
+    uint32_t Previous = 0u;
+    uint32_t Next = 0u;
+    uint32_t Generation = 0u;
+    bool Active = false;
+    /**
+     * \brief Set when the listener is detached while its channel is delivering, it is unlinked once the delivery is done.
+     */
+    bool Removed = false;
+    /**
+     * \brief Set when the listener is attached while its channel is delivering, so it only receives the next events.
+     */
+    bool Fresh = false;
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+    /**
+     * \brief Index of the profile of the listener identifier in its channel.
+     */
+    uint32_t Profile = 0u;
+#endif
+  };
+
+
+  /**
+   * \brief Generational handle of a listener, used to detach it in constant time. A handle whose listener was already detached is ignored.
+   */
+  struct ListenerHandle {
+    uint32_t Type = 0u;
+    uint32_t Index = 0u;
+    uint32_t Generation = 0u;
+
+    [[nodiscard]] bool IsValid() const { return Index != 0u; }
   };
 
+
+  /**
+   * \brief Type-erased interface of the event channels, so the dispatcher can poll and destroy them without knowing their event type.
+   */
+  class EventChannelBase {
+  public:
+    virtual ~EventChannelBase() = default;
+
+    /**
+     * \brief Delivers the events queued before the call to every listener.
+     */
+    virtual void Deliver() = 0;
+    virtual void EraseListener(uint32_t listenerId) = 0;
+    virtual bool Detach(uint32_t index, uint32_t generation) = 0;
+
+    /**
+     * \brief Moves the events posted from other threads to the queue of the channel. Must be called from the polling thread.
+     * \param recorder The recorder of the dispatcher, or nullptr if it is not recording.
+     * \param frame The frame the events are delivered on.
+     * \return The number of moved events.
+     */
+    virtual size_t DrainConcurrent(EventRecorder* recorder, uint64_t frame) = 0;
+
+    /**
+     * \brief Queues a recorded event.
+     * \param data The bytes of the event.
+     * \param size The recorded size of the event.
+     * \return True if the event was queued, false if nobody listens to it or it does not match the event type.
+     */
+    virtual bool Inject(const void* data, uint32_t size) = 0;
+
+  public:
+    /**
+     * \brief True while the channel is in the pending list of the dispatcher.
+     */
+    bool Pending = false;
+    /**
+     * \brief True while the channel is in the list of the channels with events posted from other threads.
+     */
+    std::atomic<bool> ConcurrentPending = false;
+    EventChannelBase* NextConcurrent = nullptr;
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+    bool Profiling = false;
+    /**
+     * \brief One profile per listener identifier attached to the channel so far.
+     */
+    std::vector<ListenerProfile> Profiles;
+#endif
+  };
+
+
+  /**
+   * \brief Listeners and queued events of a single event type.
+   * \details
+   * The events are stored by value in a ring buffer reused from frame to frame, so posting does not allocate once the
+   * buffer reached its peak size. The listeners live in a deque, so they never move, and are linked in a list ordered
+   * by decreasing priority then attachment order: attaching walks back from the tail only past the listeners of lower
+   * priority, which is constant time when the priorities are attached in order, and detaching through a handle is
+   * constant time. Listeners can be attached and detached while the channel is delivering.
+   */
   template<typename Event>
-  class EventRegistry {
-    using Listener = std::unique_ptr<EventListener<Event>>;
+  class EventChannel final : public EventChannelBase {
   public:
-    EventRegistry() = default;
-    virtual ~EventRegistry() = default;
+    EventChannel() {
+      // The first listener is the sentinel of the list.
+      listeners.emplace_back();
+    }
+
+    ~EventChannel() override {
+      delete concurrent.load(std::memory_order_acquire);
+    }
+
+
+    /**
+     * \brief Queues an event, merging it with the last queued one according to the coalescing policy of its type.
+     * \param args The arguments to pass to the event constructor.
+     */
+    template<typename... Args>
+    void Push(Args&&... args) {
+      constexpr CoalescePolicy policy = EventCoalescing<Event>::Policy;
+      if constexpr (policy == CoalescePolicy::KeepAll) {
+        Queue.Emplace(std::forward<Args>(args)...);
+      } else {
+        if (Queue.Empty()) {
+          Queue.Emplace(std::forward<Args>(args)...);
+        } else if constexpr (policy == CoalescePolicy::KeepLast) {
+          Queue.Back() = Event(std::forward<Args>(args)...);
+        } else {
+          EventCoalescing<Event>::Accumulate(Queue.Back(), Event(std::forward<Args>(args)...));
+        }
+      }
+    }
+
+
+    /**
+     * \brief Adds a listener after the listeners of higher or equal priority.
+     * \param callback The function called with the events.
+     * \param listenerId The identifier of the listener owner, used by EraseListener().
+     * \param priority The priority of the listener, higher priorities being called first.
+     * \return The index and generation of the listener.
+     */
+    std::pair<uint32_t, uint32_t> Attach(Delegate<void(const Event&)> callback, uint32_t listenerId, int32_t priority) {
+      uint32_t index;
+      if (freeListeners.empty()) {
+        index = static_cast<uint32_t>(listeners.size());
+        listeners.emplace_back();
+      } else {
+        index = freeListeners.back();
+        freeListeners.pop_back();
+      }
+
+      EventListener<Event>& listener = listeners[index];
+      listener.Callback = std::move(callback);
+      listener.Id = listenerId;
+      listener.Priority = priority;
+      listener.Active = true;
+      listener.Removed = false;
+      listener.Fresh = depth != 0u;
+      if (listener.Fresh) {
+        fresh.push_back(index);
+      }
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+      listener.Profile = FindProfile(listenerId);
+#endif
+
+      uint32_t previous = listeners[0].Previous;
+      while (previous != 0u && listeners[previous].Priority < priority) {
+        previous = listeners[previous].Previous;
+      }
+      listener.Previous = previous;
+      listener.Next = listeners[previous].Next;
+      listeners[listener.Next].Previous = index;
+      listeners[previous].Next = index;
+      count.fetch_add(1u, std::memory_order_relaxed);
+      return { index, listener.Generation };
+    }
+
+
+    bool Detach(uint32_t index, uint32_t generation) override {
+      if (index == 0u || index >= listeners.size()) {
+        return false;
+      }
+      EventListener<Event>& listener = listeners[index];
+      if (!listener.Active || listener.Removed || listener.Generation != generation) {
+        return false;
+      }
+      Remove(index);
+      return true;
+    }
+
+
+    void EraseListener(uint32_t listenerId) override {
+      for (uint32_t index = listeners[0].Next; index != 0u;) {
+        const uint32_t next = listeners[index].Next;
+        if (listeners[index].Id == listenerId && !listeners[index].Removed) {
+          Remove(index);
+        }
+        index = next;
+      }
+    }
+
+
+    void Deliver() override {
+      // Events posted by the listeners are delivered on the next poll, so a listener reposting its event cannot loop forever.
+      const size_t queued = Queue.Size();
+      for (size_t index = 0u; index < queued; ++index) {
+        // Moved out of the ring, which might grow while the listeners post events.
+        const Event event = std::move(Queue.Front());
+        Queue.Pop();
+        Invoke(event);
+      }
+    }
+
+
+    /**
+     * \brief Calls every listener with an event, in priority order. Can be nested when a listener dispatches an event of the same type.
+     * \param event The event to deliver.
+     */
+    void Invoke(const Event& event) {
+      depth++;
+      // The links of a removed listener stay valid until the delivery is over, so the walk can continue from it.
+      for (uint32_t index = listeners[0].Next; index != 0u; index = listeners[index].Next) {
+        EventListener<Event>& listener = listeners[index];
+        if (listener.Removed || listener.Fresh) {
+          continue;
+        }
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+        if (Profiling) {
+          const auto begin = std::chrono::steady_clock::now();
+          listener.Callback(event);
+          // Indexed after the call, since the callback can attach listeners and grow the profiles.
+          Profiles[listener.Profile].Record(std::chrono::steady_clock::now() - begin);
+          continue;
+        }
+#endif
+        listener.Callback(event);
+      }
+      if (--depth == 0u) {
+        for (const uint32_t index : removed) {
+          Unlink(index);
+        }
+        removed.clear();
+        for (const uint32_t index : fresh) {
+          listeners[index].Fresh = false;
+        }
+        fresh.clear();
+      }
+    }
+
+
+    /**
+     * \brief Tells if no listener is attached. Can be called from any thread, the answer being possibly stale off the polling thread.
+     */
+    [[nodiscard]] bool Empty() const { return count.load(std::memory_order_relaxed) == 0u; }
+
+
+    size_t DrainConcurrent(EventRecorder* recorder, uint64_t frame) override {
+      MPSCQueue<Event>* queue = concurrent.load(std::memory_order_acquire);
+      if (queue == nullptr) {
+        return 0u;
+      }
+      return queue->Drain([this, recorder, frame](Event&& event) {
+        if constexpr (EventRecording<Event>::Enabled) {
+          if (recorder != nullptr) {
+            recorder->Record(frame, EventRecording<Event>::Id, &event, sizeof(Event));
+          }
+        }
+        Push(std::move(event));
+      });
+    }
+
+
+    bool Inject(const void* data, uint32_t size) override {
+      if constexpr (EventRecording<Event>::Enabled) {
+        // A different size means the recording was made with another layout of the event.
+        if (Empty() || size != sizeof(Event)) {
+          return false;
+        }
+        alignas(Event) std::byte bytes[sizeof(Event)];
+        std::memcpy(bytes, data, sizeof(Event));
+        Push(*std::launder(reinterpret_cast<const Event*>(bytes)));
+        return true;
+      } else {
+        return false;
+      }
+    }
+
+
+    /**
+     * \brief Gets the queue of the events posted from other threads, created by the first thread posting one.
+     * \param capacity The capacity of the queue if it has to be created.
+     * \return The concurrent queue of the channel.
+     */
+    MPSCQueue<Event>& GetConcurrentQueue(size_t capacity) {
+      MPSCQueue<Event>* queue = concurrent.load(std::memory_order_acquire);
+      if (queue != nullptr) {
+        return *queue;
+      }
+      auto* created = new MPSCQueue<Event>(capacity);
+      if (!concurrent.compare_exchange_strong(queue, created, std::memory_order_acq_rel)) {
+        // Another thread created it first.
+        delete created;
+        return *queue;
+      }
+      return *created;
+    }
+
+  private:
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+    uint32_t FindProfile(uint32_t listenerId) {
+      // Few listener identifiers attach to a single event type, so a linear search is enough.
+      for (uint32_t index = 0u; index < Profiles.size(); ++index) {
+        if (Profiles[index].ListenerId == listenerId) {
+          return index;
+        }
+      }
+      ListenerProfile& profile = Profiles.emplace_back();
+      profile.Event = TypeName<Event>();
+      profile.ListenerId = listenerId;
+      return static_cast<uint32_t>(Profiles.size() - 1u);
+    }
+
+#endif
+    void Remove(uint32_t index) {
+      count.fetch_sub(1u, std::memory_order_relaxed);
+      if (depth != 0u) {
+        listeners[index].Removed = true;
+        removed.push_back(index);
+        return;
+      }
+      Unlink(index);
+    }
+
+
+    void Unlink(uint32_t index) {
+      EventListener<Event>& listener = listeners[index];
+      listeners[listener.Previous].Next = listener.Next;
+      listeners[listener.Next].Previous = listener.Previous;
+      listener.Callback = nullptr;
+      listener.Active = false;
+      listener.Removed = false;
+      listener.Fresh = false;
+      listener.Generation++;
+      freeListeners.push_back(index);
+    }
 
   public:
-    std::queue<std::unique_ptr<Event>> Queue;
-    std::vector<Listener> Listeners;
+    RingBuffer<Event> Queue;
+
+  private:
+    std::deque<EventListener<Event>> listeners;
+    std::vector<uint32_t> freeListeners;
+    // Listeners detached or attached during the current delivery.
+    std::vector<uint32_t> removed;
+    std::vector<uint32_t> fresh;
+    uint32_t depth = 0u;
+    // Only written by the polling thread, read by the concurrent posts.
+    std::atomic<uint32_t> count = 0u;
+    std::atomic<MPSCQueue<Event>*> concurrent = nullptr;
   };
 
+
+  /**
+   * \brief Handle of a delayed or repeating task, used to cancel it.
+   */
+  struct TaskHandle {
+    TimingWheel::Handle Timer;
+    /**
+     * \brief True if the task is scheduled in frames, false if it is scheduled in milliseconds.
+     */
+    bool Frames = false;
+  };
+
+
+  /**
+   * @class EventDispatcher
+   * @brief Queues the events and tasks posted during a frame and delivers them on the next poll.
+   * @details
+   * Every method must be called from the thread polling the dispatcher (the simulation thread), except
+   * PostEventConcurrent() and PostTaskConcurrent(), which any thread can call without taking a lock. The events posted
+   * from other threads go through a bounded lock-free queue per event type and are moved in batch to the regular queue
+   * at the start of the next poll.
+   */
   class EventDispatcher {
   public:
+    using TaskFunction = Delegate<void()>;
+
+    /**
+     * \brief Number of events of a single type that other threads can post between two polls.
+     */
+    static constexpr size_t ConcurrentEventCapacity = 1024u;
+
+    /**
+     * \brief Number of tasks that other threads can post between two polls.
+     */
+    static constexpr size_t ConcurrentTaskCapacity = 1024u;
+
     EventDispatcher() = default;
     virtual ~EventDispatcher() {
-      // Reminder since unused to syntax. It just means that we are iterating over the values of the registry map.
-      for (auto& [_, eventRegPtr] : registry) {
-        // We cast the void* of the Event as a char since we don't know the type of the event and just use char as a placeholder.
-        auto reg = ConvertToRegistry<char>(eventRegPtr);
-        if (reg == nullptr) {
-          continue;
-        }
-        delete reg;
-        reg = nullptr;
-      }
+      StopRecording();
     }
 
+    EventDispatcher(const EventDispatcher&) = delete;
+    EventDispatcher& operator=(const EventDispatcher&) = delete;
+
 
     /**
-     * \brief Create a new event with a listener and add it to the registry.
+     * \brief Create a new event with a listener and add it to its channel.
      * \tparam Event The type of the event to create.
      * \tparam CallbackFunc The callback function to call when the event is dispatched.
      * \param cb The callback function to call when the event is dispatched.
      * \param listenerId The unique identifier for the listener.
+     * \param priority The priority of the listener, listeners of higher priority being called first. Equal priorities are called in attachment order.
+     * \return The handle used to detach the listener in constant time.
      */
     template<typename Event, typename CallbackFunc>
-    void AttachListener(CallbackFunc&& cb, uint32_t listenerId) {
-      auto listener = std::make_unique<EventListener<Event>>(std::forward<CallbackFunc>(cb), listenerId);
-      GetRegistry<Event>()->Listeners.push_back(std::move(listener));
+    ListenerHandle AttachListener(CallbackFunc&& cb, uint32_t listenerId, int32_t priority = 0) {
+      const auto [index, generation] = GetChannel<Event>()->Attach(std::forward<CallbackFunc>(cb), listenerId, priority);
+      return { ChannelIndex::Get<Event>(), index, generation };
+    }
+
+
+    /**
+     * \brief Detach a single listener in constant time.
+     * \param handle The handle returned by AttachListener().
+     * \return True if the listener was attached, false if it was already detached.
+     */
+    bool DetachListener(ListenerHandle handle) {
+      return handle.Type < channels.size() && channels[handle.Type] != nullptr && channels[handle.Type]->Detach(handle.Index, handle.Generation);
     }
 
 
     /**
-     * \brief Detach a listener from the event registry.
+     * \brief Detach a listener from its event channel.
      * \tparam Event The type of the event to detach the listener from.
      * \param listenerId The unique identifier for the listener.
      */
     template<typename Event>
     void DetachListener(uint32_t listenerId) {
-      auto& listeners = GetRegistry<Event>()->Listeners;
-      listeners.erase(std::remove_if(listeners.begin(), listeners.end(), [&](const auto& listener) {
-        return listener->Id == listenerId;
-      }), listeners.end());
+      GetChannel<Event>()->EraseListener(listenerId);
     }
 
 
     /**
-     * \brief Erase a listener from the event registry.
+     * \brief Erase a listener from its event channel.
      * \param listenerId The unique identifier for the listener.
      */
     void EraseListener(uint32_t listenerId) {
-      for (auto& [_, eventRegPtr] : registry) {
-        auto& listeners = ConvertToRegistry<int8_t>(eventRegPtr)->Listeners;
-        listeners.erase(std::remove_if(listeners.begin(), listeners.end(), [&](const auto& listener) {
-          return listener->Id == listenerId;
-        }), listeners.end());
+      for (auto& channel : channels) {
+        if (channel != nullptr) {
+          channel->EraseListener(listenerId);
+        }
       }
     }
 
 
     /**
      * \brief Post(Add) a new event to the event queue if there are listeners for the event.
+     * \details The event is constructed in place in the ring buffer of its channel, or merged with the last queued one depending on its EventCoalescing policy.
      * \tparam Event The type of the event to post.
      * \tparam Args The arguments to pass to the event constructor.
      * \param args The arguments to pass to the event constructor.
      */
     template<typename Event, typename... Args>
     void PostEvent(Args&&... args) {
-      EventRegistry<Event>* reg = GetRegistry<Event>();
-      if (reg->Listeners.empty()) {
+      EventChannel<Event>* channel = GetChannel<Event>();
+      if constexpr (EventRecording<Event>::Enabled) {
+        if (replayer != nullptr) {
+          // The live events are replaced by the recorded ones until the end of the replay.
+          return;
+        }
+        if (recorder != nullptr) {
+          const Event event(std::forward<Args>(args)...);
+          recorder->Record(frame, EventRecording<Event>::Id, &event, sizeof(Event));
+          if (!channel->Empty()) {
+            channel->Push(event);
+            MarkPending(channel);
+          }
+          return;
+        }
+      }
+      if (channel->Empty()) {
+        return;
+      }
+      channel->Push(std::forward<Args>(args)...);
+      MarkPending(channel);
+    }
+
+
+    /**
+     * \brief Deliver an event right away to the listeners of its type, without going through the queue.
+     * \details For latency-critical events, which would otherwise wait for the next poll. Must be called from the polling thread. A listener can dispatch further events, including of its own type.
+     * \tparam Event The type of the event to dispatch.
+     * \tparam Args The arguments to pass to the event constructor.
+     * \param args The arguments to pass to the event constructor.
+     */
+    template<typename Event, typename... Args>
+    void Dispatch(Args&&... args) {
+      EventChannel<Event>* channel = GetChannel<Event>();
+      if (channel->Empty()) {
         return;
       }
-      reg->Queue.push(std::make_unique<Event>(std::forward<Args>(args)...));
+      const Event event(std::forward<Args>(args)...);
+      channel->Invoke(event);
     }
 
 
@@ -119,65 +599,415 @@ namespace HeimskrEngine {
      */
     template<typename Task>
     void PostTask(Task&& task) {
-      tasks.push(std::move(task));
+      tasks.Emplace(std::forward<Task>(task));
+    }
+
+
+    /**
+     * \brief Post an event from any thread, without locking. It is delivered on the next poll like the other events.
+     * \details The dispatcher must outlive the posting threads. Events of a type nobody listens to are dropped.
+     * \tparam Event The type of the event to post.
+     * \tparam Args The arguments to pass to the event constructor.
+     * \param args The arguments to pass to the event constructor.
+     * \return False if the event was dropped, because nobody listens to its type or ConcurrentEventCapacity events are already waiting.
+     */
+    template<typename Event, typename... Args>
+    bool PostEventConcurrent(Args&&... args) {
+      if constexpr (EventRecording<Event>::Enabled) {
+        if (replaying.load(std::memory_order_relaxed)) {
+          return false;
+        }
+      }
+      const ChannelTable* table = sharedChannels.load(std::memory_order_acquire);
+      const uint32_t index = ChannelIndex::Get<Event>();
+      if (table == nullptr || index >= table->size() || (*table)[index] == nullptr) {
+        return false;
+      }
+
+      auto* channel = static_cast<EventChannel<Event>*>((*table)[index]);
+      if (channel->Empty()) {
+        return false;
+      }
+      if (!channel->GetConcurrentQueue(ConcurrentEventCapacity).Push(std::forward<Args>(args)...)) {
+        return false;
+      }
+      // Only the first event since the last poll links the channel, the next ones are drained with it.
+      if (!channel->ConcurrentPending.exchange(true, std::memory_order_acq_rel)) {
+        EventChannelBase* head = concurrentChannels.load(std::memory_order_relaxed);
+        do {
+          channel->NextConcurrent = head;
+        } while (!concurrentChannels.compare_exchange_weak(head, channel, std::memory_order_release, std::memory_order_relaxed));
+      }
+      return true;
+    }
+
+
+    /**
+     * \brief Post a task from any thread, without locking. It runs on the polling thread during the next poll.
+     * \tparam Task The type of the task to post.
+     * \param task The task to post.
+     * \return False if the task was dropped because ConcurrentTaskCapacity tasks are already waiting.
+     */
+    template<typename Task>
+    bool PostTaskConcurrent(Task&& task) {
+      return concurrentTasks.Push(std::forward<Task>(task));
+    }
+
+
+    /**
+     * \brief Post a task running once after a delay.
+     * \tparam Task The type of the task to post.
+     * \param delay The delay, rounded up to the next PollEvents() once expired.
+     * \param task The task to post.
+     * \return The handle used to cancel the task.
+     */
+    template<typename Task>
+    TaskHandle PostDelayedTask(std::chrono::milliseconds delay, Task&& task) {
+      const auto ticks = static_cast<uint64_t>(std::max<int64_t>(delay.count(), 1));
+      return { timeWheel.Schedule(ticks + GetTimeWheelLag(), 0u, std::forward<Task>(task)), false };
+    }
+
+
+    /**
+     * \brief Post a task running periodically until it is cancelled.
+     * \tparam Task The type of the task to post.
+     * \param period The time between two runs of the task.
+     * \param task The task to post.
+     * \return The handle used to cancel the task. A task can cancel itself.
+     */
+    template<typename Task>
+    TaskHandle PostRepeatingTask(std::chrono::milliseconds period, Task&& task) {
+      const auto ticks = static_cast<uint64_t>(std::max<int64_t>(period.count(), 1));
+      return { timeWheel.Schedule(ticks + GetTimeWheelLag(), ticks, std::forward<Task>(task)), false };
+    }
+
+
+    /**
+     * \brief Post a task running once after a number of frames, i.e. calls to PollEvents().
+     * \tparam Task The type of the task to post.
+     * \param frames The number of frames to wait, 1 running the task on the next PollEvents(), even when posted from a listener or a task of the current one.
+     * \param task The task to post.
+     * \return The handle used to cancel the task.
+     */
+    template<typename Task>
+    TaskHandle PostFrameTask(uint32_t frames, Task&& task) {
+      // The frame wheel still advances at the end of the current poll, which must not count as a frame.
+      const uint32_t ticks = std::max(frames, 1u) + (delivering ? 1u : 0u);
+      return { frameWheel.Schedule(ticks, 0u, std::forward<Task>(task)), true };
+    }
+
+
+    /**
+     * \brief Cancel a delayed, repeating or frame task in constant time.
+     * \param handle The handle returned when the task was posted.
+     * \return True if the task was pending, false if it already ran or was cancelled.
+     */
+    bool CancelTask(TaskHandle handle) {
+      return (handle.Frames ? frameWheel : timeWheel).Cancel(handle.Timer);
     }
 
 
     /**
      * \brief Poll the event queue and call the listeners for the events in the queue.
+     * \details
+     * The events and tasks posted from other threads are first moved to the regular queues. Only the channels that
+     * received events since the last poll are then visited, in the order of their first event. The events posted by
+     * the listeners are delivered on the next poll. The timed tasks run after the events and the immediate tasks, the
+     * time ones last.
      */
     void PollEvents() {
-      for (auto& [_, eventRegPtr] : registry) {
-        auto reg = ConvertToRegistry<char>(eventRegPtr);
+      if (replayer != nullptr) {
+        Replay();
+      }
+      DrainConcurrent();
+      delivering = true;
 
-        while (!reg->Queue.empty()) {
-          for (auto& listener : reg->Listeners) {
-            listener->Callback(*reg->Queue.front());
-          }
-          reg->Queue.pop();
+      // Swapped out, so the listeners can post events to any channel while the pending ones are delivered.
+      polling.swap(pending);
+      for (EventChannelBase* channel : polling) {
+        channel->Pending = false;
+        channel->Deliver();
+      }
+      polling.clear();
+
+      while (!tasks.Empty()) {
+        // Moved out first, since the task can post tasks and grow the ring.
+        const TaskFunction task = std::move(tasks.Front());
+        tasks.Pop();
+        task();
+      }
+
+      delivering = false;
+      frameWheel.Advance(frameWheel.GetCurrent() + 1u);
+      const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+      timeWheel.Advance(static_cast<uint64_t>(elapsed.count()));
+      frame++;
+    }
+
+
+    /**
+     * \brief Start recording the recordable events (see HEIMSKR_RECORDABLE_EVENT) with the frame they are delivered on.
+     * \details The events posted with PostEvent() or PostEventConcurrent() are recorded, even those nobody listens to. The events delivered with Dispatch() are not.
+     * \param path The path of the recording, replaced if it exists.
+     * \return False if the file could not be opened.
+     */
+    bool StartRecording(const std::string& path) {
+      auto opened = std::make_unique<EventRecorder>();
+      if (!opened->Open(path, frame)) {
+        return false;
+      }
+      recorder = std::move(opened);
+      return true;
+    }
+
+
+    void StopRecording() {
+      if (recorder != nullptr) {
+        recorder->Close(frame);
+        recorder.reset();
+      }
+    }
+
+
+    /**
+     * \brief Start replaying a recording. Its events are posted at the same frames as they were recorded, counting from now.
+     * \details While replaying, the live events of the recordable types (e.g. the window input) are dropped. They are posted again once the recording is over.
+     * \param path The path of the recording.
+     * \return False if the file could not be read.
+     */
+    bool StartReplay(const std::string& path) {
+      auto opened = std::make_unique<EventReplayer>();
+      if (!opened->Open(path)) {
+        return false;
+      }
+      replayer = std::move(opened);
+      replayStart = frame;
+      replaying.store(true, std::memory_order_relaxed);
+      return true;
+    }
+
+
+    void StopReplay() {
+      replayer.reset();
+      replaying.store(false, std::memory_order_relaxed);
+    }
+
+
+    [[nodiscard]] bool IsRecording() const { return recorder != nullptr; }
+    [[nodiscard]] bool IsReplaying() const { return replayer != nullptr; }
+
+    /**
+     * \brief Gets the number of polls since the creation of the dispatcher.
+     * \return The current frame.
+     */
+    [[nodiscard]] uint64_t GetFrame() const { return frame; }
+
+
+    /**
+     * \brief Names a listener identifier in the profiles, e.g. after the layer owning it.
+     * \param listenerId The unique identifier for the listener.
+     * \param name The name of the listener, which must outlive the dispatcher (e.g. a string literal or TypeName()).
+     */
+    void SetListenerName(uint32_t listenerId, std::string_view name) {
+      listenerNames[listenerId] = name;
+    }
+
+
+    /**
+     * \brief Start or stop measuring the time spent in every listener, per event type and listener identifier.
+     * \details Only available when the engine is built with HEIMSKR_ENGINE_PROFILE_EVENTS, otherwise the listeners are never timed and this does nothing. Enabled, every callback costs two reads of the clock.
+     * \param enabled True to measure the listeners.
+     */
+    void SetProfiling([[maybe_unused]] bool enabled) {
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+      profiling = enabled;
+      for (auto& channel : channels) {
+        if (channel != nullptr) {
+          channel->Profiling = enabled;
         }
       }
+#endif
+    }
+
+
+    [[nodiscard]] bool IsProfiling() const {
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+      return profiling;
+#else
+      return false;
+#endif
+    }
+
 
-      while (!tasks.empty()) {
-        tasks.front()();
-        tasks.pop();
+    /**
+     * \brief Gets the time spent in the listeners since the profiling was enabled or reset.
+     * \return One profile per event type and listener identifier, empty if the engine is built without HEIMSKR_ENGINE_PROFILE_EVENTS.
+     */
+    [[nodiscard]] std::vector<ListenerProfile> GetProfiles() const {
+      std::vector<ListenerProfile> profiles;
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+      for (const auto& channel : channels) {
+        if (channel != nullptr) {
+          profiles.insert(profiles.end(), channel->Profiles.begin(), channel->Profiles.end());
+        }
       }
+      for (ListenerProfile& profile : profiles) {
+        const auto iterator = listenerNames.find(profile.ListenerId);
+        if (iterator != listenerNames.end()) {
+          profile.Listener = iterator->second;
+        }
+      }
+#endif
+      return profiles;
+    }
+
+
+    /**
+     * \brief Clears the measures of every listener, e.g. to profile the frames following a spike alone.
+     */
+    void ResetProfiles() {
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+      for (auto& channel : channels) {
+        if (channel == nullptr) {
+          continue;
+        }
+        for (ListenerProfile& profile : channel->Profiles) {
+          profile.Calls = 0u;
+          profile.Total = std::chrono::nanoseconds(0);
+          profile.Max = std::chrono::nanoseconds(0);
+        }
+      }
+#endif
     }
 
   private:
     /**
-     * \brief Convert a void pointer to an event registry pointer. This needs to be a separate function from the destructor because the destructor cannot be templated.
-     * \tparam Event The type of the event to convert to.
-     * \param ptr The void pointer to convert.
-     * \return The event registry pointer.
+     * \brief Get the channel of the specified event type. If the channel does not exist, create a new one.
+     * \tparam Event The type of the event to get the channel for.
+     * \return The event channel for the specified event type.
      */
     template<typename Event>
-    static EventRegistry<Event>* ConvertToRegistry(void* ptr) {
-      return static_cast<EventRegistry<Event>*>(ptr);
+    EventChannel<Event>* GetChannel() {
+      const uint32_t index = ChannelIndex::Get<Event>();
+      if (index >= channels.size()) {
+        channels.resize(ChannelIndex::Count());
+      }
+      auto& channel = channels[index];
+      if (channel == nullptr) {
+        channel = std::make_unique<EventChannel<Event>>();
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+        channel->Profiling = profiling;
+#endif
+        if constexpr (EventRecording<Event>::Enabled) {
+          recordableChannels[EventRecording<Event>::Id] = channel.get();
+        }
+        PublishChannels();
+      }
+      return static_cast<EventChannel<Event>*>(channel.get());
+    }
+
+
+    void MarkPending(EventChannelBase* channel) {
+      if (!channel->Pending) {
+        channel->Pending = true;
+        pending.push_back(channel);
+      }
     }
 
 
     /**
-     * \brief Get the event registry for the specified event type. If the registry does not exist, create a new one.
-     * \tparam Event The type of the event to get the registry for.
-     * \return The event registry for the specified event type.
+     * \brief Posts the recorded events of the current frame.
      */
-    template<typename Event>
-    EventRegistry<Event>* GetRegistry() {
-      auto iterator = registry.find(TypeID<Event>());
-      if (iterator != registry.end()) {
-        return ConvertToRegistry<Event>(iterator->second);
+    void Replay() {
+      replayer->Replay(frame - replayStart, [this](uint32_t type, const void* data, uint32_t size) {
+        const auto iterator = recordableChannels.find(type);
+        if (iterator != recordableChannels.end() && iterator->second->Inject(data, size)) {
+          MarkPending(iterator->second);
+        }
+      });
+      if (replayer->IsFinished()) {
+        StopReplay();
       }
-      // If the event registry does not exist, create a new one and store it in the registry.
-      EventRegistry<Event>* reg = new EventRegistry<Event>();
-      registry[TypeID<Event>()] = reg;
-      return reg;
+    }
+
+
+    /**
+     * \brief Publishes an immutable copy of the channel table for the threads posting concurrently.
+     * \details Channels are only created when a type is first used, so copying the whole table is rare. The previous copies are kept until the dispatcher is destroyed, since other threads might still read them.
+     */
+    void PublishChannels() {
+      auto table = std::make_unique<ChannelTable>(channels.size(), nullptr);
+      for (size_t index = 0u; index < channels.size(); ++index) {
+        (*table)[index] = channels[index].get();
+      }
+      sharedChannels.store(table.get(), std::memory_order_release);
+      channelTables.push_back(std::move(table));
+    }
+
+
+    /**
+     * \brief Gets the milliseconds elapsed since the time wheel last advanced, which only happens at the end of PollEvents().
+     * \details Added to the delays, so a task posted between two polls does not fire up to a frame early. Rounded up, so it never fires before its delay.
+     * \return The number of ticks the time wheel is behind the clock.
+     */
+    [[nodiscard]] uint64_t GetTimeWheelLag() const {
+      const auto elapsed = static_cast<uint64_t>(std::chrono::ceil<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+      return elapsed > timeWheel.GetCurrent() ? elapsed - timeWheel.GetCurrent() : 0u;
+    }
+
+
+    /**
+     * \brief Moves the events and tasks posted from other threads to the regular queues, in one batch per channel.
+     */
+    void DrainConcurrent() {
+      EventChannelBase* channel = concurrentChannels.exchange(nullptr, std::memory_order_acquire);
+      while (channel != nullptr) {
+        // Read before clearing the flag, since a producer can link the channel again right after.
+        EventChannelBase* next = channel->NextConcurrent;
+        channel->ConcurrentPending.exchange(false, std::memory_order_acq_rel);
+        if (channel->DrainConcurrent(recorder.get(), frame) != 0u) {
+          MarkPending(channel);
+        }
+        channel = next;
+      }
+
+      concurrentTasks.Drain([this](TaskFunction&& task) { tasks.Emplace(std::move(task)); });
     }
 
   private:
-    // We use void* type to store the event data because we don't know the type of the event.
-    // The uint32_t type is the unique identifier for the event.
-    std::unordered_map<uint32_t, void*> registry;
-    std::queue<std::function<void()>> tasks;
+    // Dense indices of the event types, shared by every dispatcher.
+    using ChannelIndex = TypeIndex<EventChannelBase>;
+    // Channels indexed by the dense index of their event type, null for the types this dispatcher never used.
+    std::vector<std::unique_ptr<EventChannelBase>> channels;
+    // Channels with queued events, delivered on the next poll.
+    std::vector<EventChannelBase*> pending;
+    std::vector<EventChannelBase*> polling;
+    // Copies of the channel table readable from any thread, the last one being the current one.
+    using ChannelTable = std::vector<EventChannelBase*>;
+    std::atomic<const ChannelTable*> sharedChannels = nullptr;
+    std::vector<std::unique_ptr<ChannelTable>> channelTables;
+    // Lock-free stack of the channels with events posted from other threads.
+    std::atomic<EventChannelBase*> concurrentChannels = nullptr;
+    MPSCQueue<TaskFunction> concurrentTasks { ConcurrentTaskCapacity };
+    // Number of polls so far, the frame number of the recordings.
+    uint64_t frame = 0u;
+    std::unique_ptr<EventRecorder> recorder;
+    std::unique_ptr<EventReplayer> replayer;
+    uint64_t replayStart = 0u;
+    // Read by the threads posting concurrently, which must not post live input while replaying.
+    std::atomic<bool> replaying = false;
+    // Channels of the recordable event types, by stable identifier.
+    std::unordered_map<uint32_t, EventChannelBase*> recordableChannels;
+    RingBuffer<TaskFunction> tasks;
+    // Delayed and repeating tasks, one tick per millisecond since the creation of the dispatcher, or one tick per poll.
+    TimingWheel timeWheel;
+    TimingWheel frameWheel;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // Set while the events and immediate tasks of a poll run, before the frame wheel advances.
+    bool delivering = false;
+    std::unordered_map<uint32_t, std::string_view> listenerNames;
+#ifdef HEIMSKR_ENGINE_PROFILE_EVENTS
+    bool profiling = false;
+#endif
   };
 }
@@ -0,0 +1,217 @@
+/**
+ * @file EventRecorder.h
+ * @brief Recording of the posted events to a compact binary file, and their replay at the same frames.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Types.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Tells if the events of a type are recorded, and under which name. Specialized with HEIMSKR_RECORDABLE_EVENT.
+   * \tparam Event The type of the event.
+   */
+  template<typename Event>
+  struct EventRecording {
+    static constexpr bool Enabled = false;
+  };
+
+
+  /**
+   * \brief Makes an event type recordable. The name is hashed into the identifier stored in the recordings, so it stays the same across builds and compilers.
+   * \details The event must be trivially copyable, since it is recorded as raw bytes. Must be used in the HeimskrEngine namespace.
+   */
+#define HEIMSKR_RECORDABLE_EVENT(Type)                                                                  \
+  template<>                                                                                            \
+  struct EventRecording<Type> {                                                                         \
+    static_assert(std::is_trivially_copyable_v<Type>, #Type " must be trivially copyable to be recorded."); \
+    static constexpr bool Enabled = true;                                                               \
+    static constexpr uint32_t Id = HashString(#Type);                                                     \
+  }
+
+
+  /**
+   * @class EventRecorder
+   * @brief Streams the recorded events to a file.
+   * @details
+   * The file starts with the FileMagic and FileVersion, followed by one record per event: the number of frames since
+   * the previous record and the event size as variable-length integers, the stable type identifier, then the raw
+   * bytes of the event. A mouse motion recorded on the frame following the previous event takes 22 bytes. The last
+   * record is an empty EndOfRecording marker on the last recorded frame, so the replay lasts as long as the recording.
+   */
+  class EventRecorder {
+  public:
+    static constexpr char FileMagic[4] = { 'H', 'K', 'E', 'V' };
+    static constexpr uint32_t FileVersion = 1u;
+    /**
+     * \brief Type identifier of the record closing the recording.
+     */
+    static constexpr uint32_t EndOfRecording = 0u;
+
+    /**
+     * \brief Opens the file the events are recorded to, replacing it.
+     * \param path The path of the recording.
+     * \param startFrame The frame the recording starts on, the recorded frames being relative to it as the replay expects.
+     * \return False if the file could not be opened.
+     */
+    bool Open(const std::string& path, uint64_t startFrame = 0u) {
+      file.open(path, std::ios::binary | std::ios::trunc);
+      if (!file) {
+        return false;
+      }
+      file.write(FileMagic, sizeof(FileMagic));
+      file.write(reinterpret_cast<const char*>(&FileVersion), sizeof(FileVersion));
+      lastFrame = startFrame;
+      return true;
+    }
+
+
+    /**
+     * \brief Appends an event to the recording.
+     * \param frame The frame the event is delivered on.
+     * \param type The stable identifier of the event type.
+     * \param data The bytes of the event.
+     * \param size The size of the event.
+     */
+    void Record(uint64_t frame, uint32_t type, const void* data, uint32_t size) {
+      WriteVarint(frame - lastFrame);
+      lastFrame = frame;
+      WriteVarint(size);
+      file.write(reinterpret_cast<const char*>(&type), sizeof(type));
+      file.write(static_cast<const char*>(data), size);
+    }
+
+
+    /**
+     * \brief Ends the recording.
+     * \param frame The last recorded frame.
+     */
+    void Close(uint64_t frame) {
+      if (!file.is_open()) {
+        return;
+      }
+      Record(frame, EndOfRecording, nullptr, 0u);
+      file.close();
+    }
+
+    [[nodiscard]] bool IsOpen() const { return file.is_open(); }
+
+  private:
+    void WriteVarint(uint64_t value) {
+      char bytes[10];
+      size_t count = 0u;
+      do {
+        bytes[count] = static_cast<char>((value & 0x7Fu) | (value > 0x7Fu ? 0x80u : 0u));
+        value >>= 7u;
+        count++;
+      } while (value != 0u);
+      file.write(bytes, static_cast<std::streamsize>(count));
+    }
+
+  private:
+    std::ofstream file;
+    uint64_t lastFrame = 0u;
+  };
+
+
+  /**
+   * @class EventReplayer
+   * @brief Reads a recording made by EventRecorder and hands its events back frame by frame.
+   */
+  class EventReplayer {
+  public:
+    /**
+     * \brief Loads a recording in memory.
+     * \param path The path of the recording.
+     * \return False if the file could not be read or is not a recording of this version.
+     */
+    bool Open(const std::string& path) {
+      std::ifstream file(path, std::ios::binary);
+      if (!file) {
+        return false;
+      }
+      data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+      uint32_t version = 0u;
+      if (data.size() < sizeof(EventRecorder::FileMagic) + sizeof(version) || std::memcmp(data.data(), EventRecorder::FileMagic, sizeof(EventRecorder::FileMagic)) != 0) {
+        data.clear();
+        return false;
+      }
+      std::memcpy(&version, data.data() + sizeof(EventRecorder::FileMagic), sizeof(version));
+      if (version != EventRecorder::FileVersion) {
+        data.clear();
+        return false;
+      }
+
+      cursor = sizeof(EventRecorder::FileMagic) + sizeof(version);
+      nextFrame = 0u;
+      ReadFrame();
+      return true;
+    }
+
+
+    /**
+     * \brief Hands the events recorded up to a frame to a function, in recording order.
+     * \tparam Function Type of the function. Must be callable as function(uint32_t type, const void* data, uint32_t size).
+     * \param frame The current frame.
+     * \param function The function receiving the events.
+     */
+    template<typename Function>
+    void Replay(uint64_t frame, Function&& function) {
+      while (!IsFinished() && nextFrame <= frame) {
+        uint64_t size = 0u;
+        uint32_t type = 0u;
+        if (!ReadVarint(size) || cursor + sizeof(type) + size > data.size()) {
+          // Truncated recording, e.g. the recording application crashed.
+          cursor = data.size();
+          return;
+        }
+        std::memcpy(&type, data.data() + cursor, sizeof(type));
+        cursor += sizeof(type);
+        function(type, data.data() + cursor, static_cast<uint32_t>(size));
+        cursor += size;
+        ReadFrame();
+      }
+    }
+
+
+    [[nodiscard]] bool IsFinished() const { return cursor >= data.size(); }
+
+  private:
+    void ReadFrame() {
+      uint64_t delta = 0u;
+      if (ReadVarint(delta)) {
+        nextFrame += delta;
+      } else {
+        cursor = data.size();
+      }
+    }
+
+
+    bool ReadVarint(uint64_t& value) {
+      value = 0u;
+      for (uint32_t shift = 0u; cursor < data.size() && shift < 64u; shift += 7u) {
+        const auto byte = static_cast<uint8_t>(data[cursor++]);
+        value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0u) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    std::vector<char> data;
+    size_t cursor = 0u;
+    uint64_t nextFrame = 0u;
+  };
+}
@@ -0,0 +1,122 @@
+/**
+ * @file MPSCQueue.h
+ * @brief Bounded lock-free queue with many producer threads and a single consumer thread.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace HeimskrEngine {
+  /**
+   * @class MPSCQueue
+   * @brief Fixed capacity queue where any thread pushes and a single thread pops, without locks.
+   * @details
+   * Bounded queue of Dmitry Vyukov: every cell carries a sequence number telling whether it is free for the producer of
+   * a given position or filled for the consumer. Producers only contend on a single compare-exchange of the enqueue
+   * position, the consumer never writes to a shared counter, and pushing never allocates. Push() fails when the queue
+   * is full instead of blocking.
+   * \tparam T The element type. Must be move constructible.
+   */
+  template<typename T>
+  class MPSCQueue {
+  public:
+    /**
+     * \brief Constructor for the MPSCQueue class.
+     * \param capacity The maximum number of queued elements, rounded up to a power of two.
+     */
+    explicit MPSCQueue(size_t capacity) {
+      size_t size = 2u;
+      while (size < capacity) {
+        size *= 2u;
+      }
+      mask = size - 1u;
+      cells = std::make_unique<Cell[]>(size);
+      for (size_t index = 0u; index < size; ++index) {
+        cells[index].Sequence.store(index, std::memory_order_relaxed);
+      }
+    }
+
+    ~MPSCQueue() {
+      Drain([](T&&) {});
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+
+    /**
+     * \brief Constructs an element at the back of the queue. Can be called from any thread.
+     * \param args The arguments passed to the constructor of the element.
+     * \return False if the queue is full, in which case nothing is constructed.
+     */
+    template<typename... Args>
+    bool Push(Args&&... args) {
+      size_t position = enqueuePosition.load(std::memory_order_relaxed);
+      Cell* cell;
+      for (;;) {
+        cell = &cells[position & mask];
+        const size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+          if (enqueuePosition.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed)) {
+            break;
+          }
+        } else if (difference < 0) {
+          // The consumer did not free the cell of the previous lap yet.
+          return false;
+        } else {
+          position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+      }
+
+      new (&cell->Storage) T(std::forward<Args>(args)...);
+      cell->Sequence.store(position + 1u, std::memory_order_release);
+      return true;
+    }
+
+
+    /**
+     * \brief Pops every element whose push completed. Must only be called from the consumer thread.
+     * \tparam Function Type of the function. Must be callable as function(T&&).
+     * \param function The function receiving the elements in queue order.
+     * \return The number of popped elements.
+     */
+    template<typename Function>
+    size_t Drain(Function&& function) {
+      size_t count = 0u;
+      for (;; ++count) {
+        Cell& cell = cells[dequeuePosition & mask];
+        if (cell.Sequence.load(std::memory_order_acquire) != dequeuePosition + 1u) {
+          return count;
+        }
+        T* element = std::launder(reinterpret_cast<T*>(&cell.Storage));
+        function(std::move(*element));
+        std::destroy_at(element);
+        // Freeing the cell for the producer of the next lap.
+        cell.Sequence.store(dequeuePosition + mask + 1u, std::memory_order_release);
+        dequeuePosition++;
+      }
+    }
+
+
+    [[nodiscard]] size_t Capacity() const { return mask + 1u; }
+
+  private:
+    struct Cell {
+      std::atomic<size_t> Sequence;
+      alignas(T) std::byte Storage[sizeof(T)];
+    };
+
+  private:
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0u;
+    // On separate cache lines, so the producers do not invalidate the line of the consumer.
+    alignas(64) std::atomic<size_t> enqueuePosition = 0u;
+    alignas(64) size_t dequeuePosition = 0u;
+  };
+}
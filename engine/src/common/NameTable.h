@@ -0,0 +1,142 @@
+/**
+ * @file NameTable.h
+ * @brief Global string-interning table giving names compact 32 bits identifiers.
+ */
+
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Compact identifier of an interned name.
+   */
+  using NameID = uint32_t;
+
+  /**
+   * \brief Identifier of the "Undefined" name, always interned first.
+   */
+  constexpr NameID UndefinedName = 0u;
+
+  /**
+   * \brief Identifier returned when a name was never interned.
+   */
+  constexpr NameID InvalidName = UINT32_MAX;
+
+
+  /**
+   * @class NameTable
+   * @brief Interns strings once and hands out their identifier.
+   * @details
+   * The characters of every name are stored contiguously in large blocks that are never freed nor moved, so the views
+   * returned by Get() stay valid for the lifetime of the program. The table is safe to use from multiple threads.
+   */
+  class NameTable {
+  public:
+    /**
+     * \brief Size of the character blocks. Longer names get a dedicated block.
+     */
+    static constexpr size_t BlockSize = 64u * 1024u;
+
+    NameTable(const NameTable&) = delete;
+    NameTable& operator=(const NameTable&) = delete;
+
+    static NameTable& GetInstance() {
+      static NameTable instance;
+      return instance;
+    }
+
+
+    /**
+     * \brief Gets the identifier of a name, interning it if it was never seen.
+     * \param name The name to intern.
+     * \return The identifier of the name.
+     */
+    NameID Intern(std::string_view name) {
+      {
+        std::shared_lock lock(mutex);
+        const auto iterator = ids.find(name);
+        if (iterator != ids.end()) {
+          return iterator->second;
+        }
+      }
+
+      std::unique_lock lock(mutex);
+      // Another thread might have interned the same name between the two locks.
+      const auto iterator = ids.find(name);
+      if (iterator != ids.end()) {
+        return iterator->second;
+      }
+
+      const std::string_view stored = Store(name);
+      const NameID id = static_cast<NameID>(names.size());
+      names.push_back(stored);
+      ids.emplace(stored, id);
+      return id;
+    }
+
+
+    /**
+     * \brief Gets the identifier of a name without interning it.
+     * \param name The name to look for.
+     * \return The identifier of the name, or InvalidName if it was never interned.
+     */
+    NameID Find(std::string_view name) const {
+      std::shared_lock lock(mutex);
+      const auto iterator = ids.find(name);
+      return iterator != ids.end() ? iterator->second : InvalidName;
+    }
+
+
+    /**
+     * \brief Gets the characters of an interned name.
+     * \param id The identifier of the name.
+     * \return The name, or an empty view if the identifier is unknown.
+     */
+    std::string_view Get(NameID id) const {
+      std::shared_lock lock(mutex);
+      return id < names.size() ? names[id] : std::string_view();
+    }
+
+  private:
+    NameTable() {
+      Intern("Undefined");
+    }
+
+
+    /**
+     * \brief Copies the characters of a name into the blocks.
+     * \param name The name to copy.
+     * \return A view over the stored copy.
+     */
+    std::string_view Store(std::string_view name) {
+      if (name.size() > BlockSize) {
+        largeBlocks.push_back(std::make_unique<char[]>(name.size()));
+        name.copy(largeBlocks.back().get(), name.size());
+        return { largeBlocks.back().get(), name.size() };
+      }
+      if (blocks.empty() || blockUsed + name.size() > BlockSize) {
+        blocks.push_back(std::make_unique<char[]>(BlockSize));
+        blockUsed = 0u;
+      }
+      char* destination = blocks.back().get() + blockUsed;
+      name.copy(destination, name.size());
+      blockUsed += name.size();
+      return { destination, name.size() };
+    }
+
+  private:
+    mutable std::shared_mutex mutex;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<std::unique_ptr<char[]>> largeBlocks;
+    size_t blockUsed = 0u;
+    std::deque<std::string_view> names;
+    std::unordered_map<std::string_view, NameID> ids;
+  };
+}
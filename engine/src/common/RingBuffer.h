@@ -0,0 +1,138 @@
+/**
+ * @file RingBuffer.h
+ * @brief Growable FIFO ring buffer storing its elements by value in a single reusable allocation.
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace HeimskrEngine {
+  /**
+   * @class RingBuffer
+   * @brief FIFO queue over a power-of-two circular array.
+   * @details
+   * The storage doubles when full and is never shrunk, so once it reached the peak size of the queue, pushing and
+   * popping never allocate. Unlike std::queue over a std::deque, the elements are contiguous in at most two runs.
+   * \tparam T The element type. Must be move constructible.
+   */
+  template<typename T>
+  class RingBuffer {
+  public:
+    RingBuffer() = default;
+
+    explicit RingBuffer(size_t capacity) {
+      Reserve(capacity);
+    }
+
+    ~RingBuffer() {
+      Clear();
+      Deallocate();
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+
+    /**
+     * \brief Constructs an element at the back of the queue.
+     * \param args The arguments passed to the constructor of the element.
+     * \return The new element.
+     */
+    template<typename... Args>
+    T& Emplace(Args&&... args) {
+      if (count == capacity) {
+        Reserve(capacity == 0u ? InitialCapacity : capacity * 2u);
+      }
+      T* element = new (&elements[(head + count) & (capacity - 1u)]) T(std::forward<Args>(args)...);
+      count++;
+      return *element;
+    }
+
+
+    /**
+     * \brief Removes the element at the front of the queue. The queue must not be empty.
+     */
+    void Pop() {
+      std::destroy_at(&Front());
+      head = (head + 1u) & (capacity - 1u);
+      count--;
+    }
+
+
+    /**
+     * \brief Destroys every element, keeping the storage.
+     */
+    void Clear() {
+      while (count != 0u) {
+        Pop();
+      }
+      head = 0u;
+    }
+
+
+    /**
+     * \brief Grows the storage so it holds at least a number of elements.
+     * \param minimum The number of elements to hold without growing.
+     */
+    void Reserve(size_t minimum) {
+      if (minimum <= capacity) {
+        return;
+      }
+      size_t newCapacity = capacity == 0u ? InitialCapacity : capacity;
+      while (newCapacity < minimum) {
+        newCapacity *= 2u;
+      }
+
+      auto* newElements = static_cast<Storage*>(::operator new(newCapacity * sizeof(Storage), std::align_val_t(alignof(T))));
+      for (size_t index = 0u; index < count; ++index) {
+        T& element = At(index);
+        new (&newElements[index]) T(std::move(element));
+        std::destroy_at(&element);
+      }
+      Deallocate();
+      elements = newElements;
+      capacity = newCapacity;
+      head = 0u;
+    }
+
+
+    [[nodiscard]] T& Front() { return At(0u); }
+    [[nodiscard]] const T& Front() const { return At(0u); }
+    [[nodiscard]] T& Back() { return At(count - 1u); }
+    [[nodiscard]] const T& Back() const { return At(count - 1u); }
+    [[nodiscard]] bool Empty() const { return count == 0u; }
+    [[nodiscard]] size_t Size() const { return count; }
+    [[nodiscard]] size_t Capacity() const { return capacity; }
+
+  private:
+    static constexpr size_t InitialCapacity = 16u;
+
+    struct Storage {
+      alignas(T) std::byte Bytes[sizeof(T)];
+    };
+
+    T& At(size_t index) {
+      return *std::launder(reinterpret_cast<T*>(&elements[(head + index) & (capacity - 1u)]));
+    }
+
+    const T& At(size_t index) const {
+      return *std::launder(reinterpret_cast<const T*>(&elements[(head + index) & (capacity - 1u)]));
+    }
+
+    void Deallocate() {
+      if (elements != nullptr) {
+        ::operator delete(elements, std::align_val_t(alignof(T)));
+        elements = nullptr;
+      }
+    }
+
+  private:
+    Storage* elements = nullptr;
+    size_t capacity = 0u;
+    size_t head = 0u;
+    size_t count = 0u;
+  };
+}
@@ -0,0 +1,260 @@
+/**
+ * @file TimingWheel.h
+ * @brief Hierarchical timing wheel scheduling delayed and repeating callbacks in constant time.
+ */
+
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Delegate.h"
+
+namespace HeimskrEngine {
+  /**
+   * @class TimingWheel
+   * @brief Schedules callbacks on a discrete tick counter (milliseconds, frames, ...) with O(1) scheduling and cancellation.
+   * @details
+   * The timers are spread over Levels wheels of Slots slots each. The first wheel holds the timers expiring within the
+   * next Slots ticks, one slot per tick, and every following wheel covers Slots times the range of the previous one.
+   * When the first wheel completes a turn, the next slot of the second wheel is cascaded down into it, and so on. The
+   * timer nodes are recycled through a free list and linked by index, so once the wheel is warmed up neither firing
+   * nor rescheduling a repeating timer allocates.
+   */
+  class TimingWheel {
+  public:
+    using Callback = Delegate<void()>;
+
+    static constexpr uint32_t SlotBits = 6u;
+    static constexpr uint32_t Slots = 1u << SlotBits;
+    static constexpr uint32_t Levels = 4u;
+    /**
+     * \brief Longest delay handled without an extra cascade. Longer delays are supported but revisited every MaxDelay ticks.
+     */
+    static constexpr uint64_t MaxDelay = (1ull << (SlotBits * Levels)) - 1u;
+
+    /**
+     * \brief Generational handle of a timer. A handle whose timer fired or was cancelled is simply ignored.
+     */
+    struct Handle {
+      uint32_t Index = UINT32_MAX;
+      uint32_t Generation = 0u;
+
+      [[nodiscard]] bool IsValid() const { return Index != UINT32_MAX; }
+    };
+
+    TimingWheel() {
+      // The first nodes are the sentinels of the slot lists and of the list of expired timers.
+      nodes.resize(Levels * Slots + 1u);
+      for (uint32_t index = 0u; index < nodes.size(); ++index) {
+        nodes[index].Previous = index;
+        nodes[index].Next = index;
+      }
+    }
+
+
+    /**
+     * \brief Schedules a callback.
+     * \param delay The number of ticks before the first call, at least 1.
+     * \param period The number of ticks between two calls, or 0 to call it once.
+     * \param callback The function to call.
+     * \return The handle used to cancel the timer.
+     */
+    Handle Schedule(uint64_t delay, uint64_t period, Callback callback) {
+      uint32_t index;
+      if (freeNodes.empty()) {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+      } else {
+        index = freeNodes.back();
+        freeNodes.pop_back();
+      }
+
+      Node& node = nodes[index];
+      node.Expiry = current + (delay == 0u ? 1u : delay);
+      node.Period = period;
+      node.Function = std::move(callback);
+      node.Active = true;
+      node.Cancelled = false;
+      Insert(index);
+      count++;
+      return { index, node.Generation };
+    }
+
+
+    /**
+     * \brief Cancels a timer. A repeating timer can cancel itself from its callback.
+     * \param handle The handle returned by Schedule().
+     * \return True if the timer was pending, false if it already fired or was cancelled.
+     */
+    bool Cancel(Handle handle) {
+      if (!IsPending(handle)) {
+        return false;
+      }
+      Node& node = nodes[handle.Index];
+      if (node.Firing) {
+        // The callback is running, the node is released once it returns.
+        node.Cancelled = true;
+        return true;
+      }
+      Unlink(handle.Index);
+      Release(handle.Index);
+      return true;
+    }
+
+
+    /**
+     * \brief Checks if a timer is still scheduled.
+     * \param handle The handle returned by Schedule().
+     * \return True if the timer will fire again.
+     */
+    [[nodiscard]] bool IsPending(Handle handle) const {
+      if (handle.Index < FirstTimer || handle.Index >= nodes.size()) {
+        return false;
+      }
+      const Node& node = nodes[handle.Index];
+      return node.Active && !node.Cancelled && node.Generation == handle.Generation;
+    }
+
+
+    /**
+     * \brief Advances the wheel to a tick, firing every timer expiring on the way, in expiry order.
+     * \param target The new current tick. Nothing happens if it is in the past.
+     */
+    void Advance(uint64_t target) {
+      while (current < target) {
+        if (count == 0u) {
+          // Nothing to fire, the ticks can be skipped at once.
+          current = target;
+          return;
+        }
+        current++;
+
+        for (uint32_t level = 1u; level < Levels; ++level) {
+          if ((current & ((1ull << (level * SlotBits)) - 1u)) != 0u) {
+            break;
+          }
+          Cascade(level, static_cast<uint32_t>((current >> (level * SlotBits)) & (Slots - 1u)));
+        }
+
+        Fire(static_cast<uint32_t>(current & (Slots - 1u)));
+      }
+    }
+
+
+    [[nodiscard]] uint64_t GetCurrent() const { return current; }
+    [[nodiscard]] size_t GetCount() const { return count; }
+
+  private:
+    struct Node {
+      uint64_t Expiry = 0u;
+      uint64_t Period = 0u;
+      uint32_t Previous = 0u;
+      uint32_t Next = 0u;
+      uint32_t Generation = 0u;
+      bool Active = false;
+      bool Firing = false;
+      bool Cancelled = false;
+      Callback Function;
+    };
+
+    static constexpr uint32_t ExpiredList = Levels * Slots;
+    static constexpr uint32_t FirstTimer = ExpiredList + 1u;
+
+    /**
+     * \brief Links a node in the slot matching its expiry.
+     */
+    void Insert(uint32_t index) {
+      const uint64_t expiry = nodes[index].Expiry;
+      const uint64_t delay = expiry - current;
+
+      uint32_t level = 0u;
+      while (level + 1u < Levels && delay >= (1ull << ((level + 1u) * SlotBits))) {
+        level++;
+      }
+      // Delays beyond the last wheel wait in its farthest slot, and are placed again when it cascades.
+      const uint64_t slotTick = delay > MaxDelay ? current + MaxDelay : expiry;
+      const auto slot = static_cast<uint32_t>((slotTick >> (level * SlotBits)) & (Slots - 1u));
+      Link(level * Slots + slot, index);
+    }
+
+
+    /**
+     * \brief Moves the timers of a slot to the lower wheels.
+     */
+    void Cascade(uint32_t level, uint32_t slot) {
+      const uint32_t sentinel = level * Slots + slot;
+      while (nodes[sentinel].Next != sentinel) {
+        const uint32_t index = nodes[sentinel].Next;
+        Unlink(index);
+        Insert(index);
+      }
+    }
+
+
+    /**
+     * \brief Calls the timers of a slot of the first wheel.
+     */
+    void Fire(uint32_t slot) {
+      // Moved to their own list first, so the callbacks can schedule timers in this slot or cancel the pending ones.
+      while (nodes[slot].Next != slot) {
+        const uint32_t index = nodes[slot].Next;
+        Unlink(index);
+        Link(ExpiredList, index);
+      }
+
+      while (nodes[ExpiredList].Next != ExpiredList) {
+        const uint32_t index = nodes[ExpiredList].Next;
+        Unlink(index);
+
+        // The nodes live in a deque, so the reference stays valid if the callback schedules new timers.
+        Node& node = nodes[index];
+        node.Firing = true;
+        node.Function();
+        node.Firing = false;
+
+        if (node.Period == 0u || node.Cancelled) {
+          Release(index);
+        } else {
+          node.Expiry = current + node.Period;
+          Insert(index);
+        }
+      }
+    }
+
+
+    void Link(uint32_t sentinel, uint32_t index) {
+      Node& node = nodes[index];
+      node.Previous = nodes[sentinel].Previous;
+      node.Next = sentinel;
+      nodes[node.Previous].Next = index;
+      nodes[sentinel].Previous = index;
+    }
+
+
+    void Unlink(uint32_t index) {
+      Node& node = nodes[index];
+      nodes[node.Previous].Next = node.Next;
+      nodes[node.Next].Previous = node.Previous;
+      node.Previous = index;
+      node.Next = index;
+    }
+
+
+    void Release(uint32_t index) {
+      Node& node = nodes[index];
+      node.Function = nullptr;
+      node.Active = false;
+      node.Cancelled = false;
+      node.Generation++;
+      freeNodes.push_back(index);
+      count--;
+    }
+
+  private:
+    std::deque<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint64_t current = 0u;
+    size_t count = 0u;
+  };
+}
@@ -4,16 +4,100 @@
  */
 
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include <string_view>
 
 namespace HeimskrEngine {
   /**
-   * \brief Allows for the conversion of a type to a unique identifier.
+   * \brief Hashes a string with 32-bit FNV-1a, at compile time when possible.
+   * \param text The string to hash.
+   * \return The hash of the string.
+   */
+  constexpr uint32_t HashString(std::string_view text) {
+    uint32_t hash = 2166136261u;
+    for (const char character : text) {
+      hash = (hash ^ static_cast<uint8_t>(character)) * 16777619u;
+    }
+    return hash;
+  }
+
+
+  /**
+   * \brief Gets the signature of this function for a type, which the compiler spells with the full name of the type.
+   * \tparam T The specified type (Can be any type)
+   * \return The signature, unique to the type for a given compiler.
+   */
+  template<typename T>
+  constexpr std::string_view TypeSignature() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return __FUNCSIG__;
+#else
+    return __PRETTY_FUNCTION__;
+#endif
+  }
+
+
+  /**
+   * \brief Gets the name of a type as the compiler spells it, for display (e.g. in the profilers).
+   * \details The name is a view of a string literal, so it lives as long as the program.
+   * \tparam T The specified type (Can be any type)
+   * \return The name of the type, e.g. "KeyPressEvent" with GCC or "struct HeimskrEngine::KeyPressEvent" with MSVC.
+   */
+  template<typename T>
+  constexpr std::string_view TypeName() {
+    // The signature of a known type tells how much the compiler writes around the name of the type.
+    constexpr std::string_view probe = TypeSignature<double>();
+    constexpr size_t prefix = probe.find("double");
+    constexpr size_t suffix = probe.size() - prefix - std::string_view("double").size();
+    constexpr std::string_view signature = TypeSignature<T>();
+    return signature.substr(prefix, signature.size() - prefix - suffix);
+  }
+
+
+  /**
+   * \brief Allows for the conversion of a type to a unique identifier, computed at compile time.
+   * \details The identifier is a hash of the type name, so it is the same in every build made with the same compiler, but not across compilers.
    * \tparam T The specified type (Can be any type)
    * \return The unique identifier for the specified type
    */
   template<typename T>
-  uint32_t TypeID() {
-    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&typeid(T)));
+  constexpr uint32_t TypeID() {
+    constexpr uint32_t id = HashString(TypeSignature<T>());
+    return id;
   }
+
+
+  /**
+   * @class TypeIndex
+   * @brief Gives the types of a family dense indices, starting at 0 in the order they are first used, to index flat arrays.
+   * @details Each index is assigned once, in a function-local static, so after the first call it costs a single load. Thread-safe.
+   * \tparam Family The family of the types, every family counting from 0.
+   */
+  template<typename Family>
+  class TypeIndex {
+  public:
+    /**
+     * \brief Gets the index of a type in the family.
+     * \tparam T The specified type (Can be any type)
+     * \return The index of the type.
+     */
+    template<typename T>
+    static uint32_t Get() {
+      static const uint32_t index = counter.fetch_add(1u, std::memory_order_relaxed);
+      return index;
+    }
+
+
+    /**
+     * \brief Gets the number of types given an index so far.
+     * \return The number of indices.
+     */
+    static uint32_t Count() {
+      return counter.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static inline std::atomic<uint32_t> counter = 0u;
+  };
 }
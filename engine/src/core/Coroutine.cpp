@@ -0,0 +1,207 @@
+/**
+ * @file Coroutine.cpp
+ * @brief Method implementations for the engine coroutines.
+ */
+
+#include "Coroutine.h"
+
+#include <algorithm>
+#include <functional>
+#include <new>
+
+#include "../logging/Logger.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Destructor for the CoroutineFramePool class. Releases the pooled frames of the thread.
+   */
+  CoroutineFramePool::~CoroutineFramePool() {
+    for (FreeFrame*& list : freeLists) {
+      while (list != nullptr) {
+        FreeFrame* next = list->Next;
+        ::operator delete(list);
+        list = next;
+      }
+    }
+  }
+
+
+  /**
+   * \brief Gets a frame from the pool, or from the heap if its size class is empty.
+   * \param size The size of the coroutine frame.
+   * \return The frame memory.
+   */
+  void* CoroutineFramePool::Allocate(size_t size) {
+    if (size > MaxPooledSize) {
+      return ::operator new(size);
+    }
+    const size_t sizeClass = (size + ClassSize - 1u) / ClassSize - 1u;
+    FreeFrame*& list = freeLists[sizeClass];
+    if (list == nullptr) {
+      return ::operator new((sizeClass + 1u) * ClassSize);
+    }
+    FreeFrame* frame = list;
+    list = frame->Next;
+    return frame;
+  }
+
+
+  /**
+   * \brief Gives a frame back to the pool.
+   * \param frame The frame memory.
+   * \param size The size of the coroutine frame, as given to Allocate().
+   */
+  void CoroutineFramePool::Free(void* frame, size_t size) {
+    if (size > MaxPooledSize) {
+      ::operator delete(frame);
+      return;
+    }
+    const size_t sizeClass = (size + ClassSize - 1u) / ClassSize - 1u;
+    auto* node = static_cast<FreeFrame*>(frame);
+    node->Next = freeLists[sizeClass];
+    freeLists[sizeClass] = node;
+  }
+
+
+  /**
+   * \brief Called when a coroutine throws. The coroutine ends, the engine keeps running.
+   */
+  void Coroutine::promise_type::unhandled_exception() {
+    HEIMSKR_ERROR("Unhandled exception in a coroutine. The coroutine was stopped.");
+  }
+
+
+  /**
+   * \brief Destructor for the CoroutineScheduler class. Destroys every suspended coroutine.
+   */
+  CoroutineScheduler::~CoroutineScheduler() {
+    dispatcher->EraseListener(TypeID<CoroutineScheduler>());
+
+    for (const auto& suspended : nextFrame) {
+      suspended.Handle.destroy();
+    }
+    for (const auto& suspended : delivered) {
+      suspended.Handle.destroy();
+    }
+    for (const auto& timer : timers) {
+      timer.Handle.destroy();
+    }
+    for (auto& [_, head] : events) {
+      while (head != nullptr) {
+        // The waiter lives in the frame, so the next one is read before destroying it.
+        EventWaiter* waiter = head;
+        head = waiter->Next;
+        waiter->Handle.destroy();
+      }
+    }
+  }
+
+
+  /**
+   * \brief Resumes the coroutines whose event was delivered, those waiting for this frame and the expired timers.
+   * \param time The current simulation time, in seconds.
+   */
+  void CoroutineScheduler::Resume(double time) {
+    this->time = time;
+
+    // Swapping first, so the coroutines waiting again are resumed on the next frame and not in this loop.
+    resuming.swap(delivered);
+    for (const auto& suspended : resuming) {
+      suspended.Handle.resume();
+    }
+    resuming.clear();
+
+    resuming.swap(nextFrame);
+    for (const auto& suspended : resuming) {
+      suspended.Handle.resume();
+    }
+    resuming.clear();
+
+    while (!timers.empty() && timers.front().Time <= time) {
+      const auto handle = timers.front().Handle;
+      std::pop_heap(timers.begin(), timers.end(), std::greater<>());
+      timers.pop_back();
+      handle.resume();
+    }
+  }
+
+
+  /**
+   * \brief Suspends a coroutine until the next call to Resume().
+   * \param handle The suspended coroutine.
+   * \param owner The identifier of the layer the coroutine belongs to.
+   */
+  void CoroutineScheduler::WaitFrame(std::coroutine_handle<> handle, uint32_t owner) {
+    nextFrame.push_back({ handle, owner });
+  }
+
+
+  /**
+   * \brief Suspends a coroutine until a simulation time.
+   * \param time The simulation time at which to resume the coroutine, in seconds.
+   * \param handle The suspended coroutine.
+   * \param owner The identifier of the layer the coroutine belongs to.
+   */
+  void CoroutineScheduler::WaitUntil(double time, std::coroutine_handle<> handle, uint32_t owner) {
+    timers.push_back({ time, handle, owner });
+    std::push_heap(timers.begin(), timers.end(), std::greater<>());
+  }
+
+
+  /**
+   * \brief Destroys the suspended coroutines of a layer, so none of them resumes once the layer is deleted.
+   * \details Must not be called while Resume() runs. Walks every waiting coroutine, which is fine since layers are rarely detached.
+   * \param owner The identifier of the layer.
+   */
+  void CoroutineScheduler::Destroy(uint32_t owner) {
+    const auto destroy = [owner](const auto& suspended) {
+      if (suspended.Owner != owner) {
+        return false;
+      }
+      suspended.Handle.destroy();
+      return true;
+    };
+    nextFrame.erase(std::remove_if(nextFrame.begin(), nextFrame.end(), destroy), nextFrame.end());
+    delivered.erase(std::remove_if(delivered.begin(), delivered.end(), destroy), delivered.end());
+    const auto timerCount = timers.size();
+    timers.erase(std::remove_if(timers.begin(), timers.end(), destroy), timers.end());
+    if (timers.size() != timerCount) {
+      std::make_heap(timers.begin(), timers.end(), std::greater<>());
+    }
+
+    for (auto& [_, head] : events) {
+      EventWaiter** link = &head;
+      while (*link != nullptr) {
+        // The waiter lives in the frame, so it is unlinked before destroying it.
+        EventWaiter* waiter = *link;
+        if (waiter->Owner == owner) {
+          *link = waiter->Next;
+          waiter->Handle.destroy();
+        } else {
+          link = &waiter->Next;
+        }
+      }
+    }
+  }
+
+
+  /**
+   * \brief Gives an event to the waiters of its type, moving the ones accepting it to the coroutines to resume.
+   * \param head The head of the waiter list of the event type.
+   * \param event The dispatched event.
+   */
+  void CoroutineScheduler::Deliver(EventWaiter** head, const void* event) {
+    EventWaiter* waiter = *head;
+    EventWaiter** link = head;
+    while (waiter != nullptr) {
+      EventWaiter* next = waiter->Next;
+      if (waiter->Deliver(event)) {
+        *link = next;
+        delivered.push_back({ waiter->Handle, waiter->Owner });
+      } else {
+        link = &waiter->Next;
+      }
+      waiter = next;
+    }
+  }
+}
@@ -0,0 +1,263 @@
+/**
+ * @file Coroutine.h
+ * @brief C++20 coroutines for multi-frame logic, resumed by the engine on frames, timers, events and asset loads.
+ */
+
+#pragma once
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "../assets/AssetLoader.h"
+#include "../common/Event.h"
+#include "../common/Types.h"
+
+namespace HeimskrEngine {
+  /**
+   * @class CoroutineFramePool
+   * @brief Recycles the frames of the coroutines, sorted in size classes, so starting a coroutine does not reach the heap once warmed up.
+   * @details The pool is per thread, a frame freed on another thread than the one that allocated it goes to the pool of the freeing thread.
+   */
+  class CoroutineFramePool {
+  public:
+    /**
+     * \brief Granularity of the size classes.
+     */
+    static constexpr size_t ClassSize = 64u;
+
+    /**
+     * \brief Frames above this size are not pooled.
+     */
+    static constexpr size_t MaxPooledSize = 2048u;
+
+    CoroutineFramePool() = default;
+    ~CoroutineFramePool();
+
+    CoroutineFramePool(const CoroutineFramePool&) = delete;
+    CoroutineFramePool& operator=(const CoroutineFramePool&) = delete;
+
+    static CoroutineFramePool& GetInstance() {
+      thread_local CoroutineFramePool instance;
+      return instance;
+    }
+
+    void* Allocate(size_t size);
+    void Free(void* frame, size_t size);
+
+  private:
+    struct FreeFrame {
+      FreeFrame* Next;
+    };
+
+    std::array<FreeFrame*, MaxPooledSize / ClassSize> freeLists {};
+  };
+
+
+  /**
+   * \brief Return type of the engine coroutines.
+   * \details
+   * A coroutine starts running as soon as it is called, until its first suspension, and its frame is destroyed when it
+   * completes. It is not owned by its caller: a suspended coroutine belongs to the CoroutineScheduler, which resumes it
+   * and destroys it at shutdown. Every suspension is tagged with the layer whose awaitable it used, and the coroutines
+   * of a layer are destroyed when the layer is detached, so they never resume into a deleted layer.
+   */
+  struct Coroutine {
+    struct promise_type {
+      Coroutine get_return_object() { return {}; }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception();
+
+      static void* operator new(size_t size) {
+        return CoroutineFramePool::GetInstance().Allocate(size);
+      }
+
+      static void operator delete(void* frame, size_t size) {
+        CoroutineFramePool::GetInstance().Free(frame, size);
+      }
+    };
+  };
+
+
+  /**
+   * \brief Node of the intrusive list of the coroutines waiting for an event, stored inside the suspended coroutine frame.
+   */
+  struct EventWaiter {
+    virtual ~EventWaiter() = default;
+
+    /**
+     * \brief Gives an event to the waiter.
+     * \param event The dispatched event, of the type the waiter listens to.
+     * \return True if the waiter accepted the event and its coroutine must be resumed.
+     */
+    virtual bool Deliver(const void* event) = 0;
+
+    EventWaiter* Next = nullptr;
+    std::coroutine_handle<> Handle;
+    uint32_t Owner = 0u;
+  };
+
+
+  /**
+   * @class CoroutineScheduler
+   * @brief Keeps the suspended coroutines and resumes them when what they wait for happens.
+   * @details
+   * Nothing is polled: the coroutines waiting for the next frame are swapped out and resumed once per frame, the timers
+   * are kept in a min-heap of which only the top is checked, and the coroutines waiting for an event are linked in an
+   * intrusive list walked by a single listener of the event dispatcher. The coroutines receiving their event are resumed
+   * with the others by Resume(), outside of the event polling, so they can freely attach listeners or post events.
+   * Must be used from the simulation thread.
+   */
+  class CoroutineScheduler {
+  public:
+    explicit CoroutineScheduler(EventDispatcher* dispatcher) : dispatcher(dispatcher) {
+      dispatcher->SetListenerName(TypeID<CoroutineScheduler>(), "Coroutines");
+    }
+    ~CoroutineScheduler();
+
+    CoroutineScheduler(const CoroutineScheduler&) = delete;
+    CoroutineScheduler& operator=(const CoroutineScheduler&) = delete;
+
+    void Resume(double time);
+    void WaitFrame(std::coroutine_handle<> handle, uint32_t owner);
+    void WaitUntil(double time, std::coroutine_handle<> handle, uint32_t owner);
+    void Destroy(uint32_t owner);
+    [[nodiscard]] double GetTime() const { return time; }
+
+
+    /**
+     * \brief Links a waiter to the list of an event type, attaching the listener of this type on first use.
+     * \tparam Event The type of the event.
+     * \param waiter The waiter, living in the suspended coroutine frame.
+     */
+    template<typename Event>
+    void WaitEvent(EventWaiter* waiter) {
+      auto [iterator, inserted] = events.try_emplace(TypeID<Event>(), nullptr);
+      if (inserted) {
+        EventWaiter** head = &iterator->second;
+        dispatcher->AttachListener<Event>([this, head](const Event& event) { Deliver(head, &event); }, TypeID<CoroutineScheduler>());
+      }
+      waiter->Next = iterator->second;
+      iterator->second = waiter;
+    }
+
+  private:
+    void Deliver(EventWaiter** head, const void* event);
+
+    struct Suspended {
+      std::coroutine_handle<> Handle;
+      uint32_t Owner;
+    };
+
+    struct Timer {
+      double Time;
+      std::coroutine_handle<> Handle;
+      uint32_t Owner;
+
+      bool operator>(const Timer& other) const { return Time > other.Time; }
+    };
+
+  private:
+    EventDispatcher* dispatcher;
+    double time = 0.0;
+    std::vector<Suspended> nextFrame;
+    // Coroutines that received their event during the last poll.
+    std::vector<Suspended> delivered;
+    std::vector<Suspended> resuming;
+    // Min-heap on the time, kept in a vector so the timers of a detached layer can be removed.
+    std::vector<Timer> timers;
+    // Head of the waiter list of every event type. The map never erases, so the heads have stable addresses.
+    std::unordered_map<uint32_t, EventWaiter*> events;
+  };
+
+
+  /**
+   * \brief Awaitable suspending a coroutine until the next frame.
+   */
+  struct NextFrameAwaiter {
+    CoroutineScheduler* Scheduler;
+    uint32_t Owner;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const { Scheduler->WaitFrame(handle, Owner); }
+    void await_resume() const noexcept {}
+  };
+
+
+  /**
+   * \brief Awaitable suspending a coroutine for a duration of simulation time.
+   */
+  struct SecondsAwaiter {
+    CoroutineScheduler* Scheduler;
+    double Seconds;
+    uint32_t Owner;
+
+    bool await_ready() const noexcept { return Seconds <= 0.0; }
+    void await_suspend(std::coroutine_handle<> handle) const { Scheduler->WaitUntil(Scheduler->GetTime() + Seconds, handle, Owner); }
+    void await_resume() const noexcept {}
+  };
+
+
+  /**
+   * \brief Awaitable suspending a coroutine until an event is dispatched, returning a copy of the event.
+   * \tparam Event The type of the event.
+   */
+  template<typename Event>
+  struct EventAwaiter : EventWaiter {
+    EventAwaiter(CoroutineScheduler* scheduler, uint32_t owner) : Scheduler(scheduler) {
+      Owner = owner;
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      Handle = handle;
+      Scheduler->WaitEvent<Event>(this);
+    }
+
+    Event await_resume() { return std::move(*Result); }
+
+    bool Deliver(const void* event) override {
+      Result.emplace(*static_cast<const Event*>(event));
+      return true;
+    }
+
+    CoroutineScheduler* Scheduler;
+    std::optional<Event> Result;
+  };
+
+
+  /**
+   * \brief Awaitable suspending a coroutine until a model is loaded, returning the model handle.
+   */
+  struct AssetAwaiter : EventWaiter {
+    AssetAwaiter(CoroutineScheduler* scheduler, ModelHandle model, uint32_t owner) : Scheduler(scheduler), Model(std::move(model)) {
+      Owner = owner;
+    }
+
+    bool await_ready() const noexcept {
+      const AssetState state = Model->GetState();
+      return state == AssetState::Ready || state == AssetState::Failed;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      Handle = handle;
+      Scheduler->WaitEvent<AssetLoadedEvent>(this);
+    }
+
+    ModelHandle await_resume() { return std::move(Model); }
+
+    bool Deliver(const void* event) override {
+      return static_cast<const AssetLoadedEvent*>(event)->Model == Model;
+    }
+
+    CoroutineScheduler* Scheduler;
+    ModelHandle Model;
+  };
+}
@@ -0,0 +1,254 @@
+/**
+ * @file JobSystem.cpp
+ * @brief Method implementations for the JobSystem class.
+ */
+
+#include "JobSystem.h"
+
+namespace HeimskrEngine {
+  namespace {
+    /**
+     * \brief Number of times an idle worker looks for work again before going to sleep.
+     */
+    constexpr uint32_t SpinCount = 64u;
+
+    thread_local JobSystem* currentSystem = nullptr;
+    thread_local uint32_t currentIndex = JobSystem::ForeignThread;
+  }
+
+
+  /**
+   * \brief Constructor for the JobSystem class. The calling thread becomes worker 0.
+   * \param threadCount The number of threads executing jobs, including the calling thread. 0 uses every hardware thread.
+   */
+  JobSystem::JobSystem(uint32_t threadCount) {
+    if (threadCount == 0u) {
+      threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (uint32_t index = 0u; index < threadCount; ++index) {
+      workers.push_back(std::make_unique<Worker>());
+      // Any non-zero seed works for the xorshift generator used to pick the victims.
+      workers.back()->RandomState = (index + 1u) * 2654435761u;
+    }
+
+    previousSystem = currentSystem;
+    previousIndex = currentIndex;
+    currentSystem = this;
+    currentIndex = 0u;
+
+    for (uint32_t index = 1u; index < threadCount; ++index) {
+      threads.emplace_back(&JobSystem::WorkerLoop, this, index);
+    }
+  }
+
+
+  /**
+   * \brief Destructor for the JobSystem class. Stops and joins the workers, the jobs that were not started are dropped.
+   */
+  JobSystem::~JobSystem() {
+    running.store(false, std::memory_order_release);
+    wakeEpoch.fetch_add(1u, std::memory_order_seq_cst);
+    wakeEpoch.notify_all();
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    for (const Job* job : injection) {
+      delete job;
+    }
+
+    if (currentSystem == this) {
+      currentSystem = previousSystem;
+      currentIndex = previousIndex;
+    }
+  }
+
+
+  /**
+   * \brief Waits until every job of a counter is done. Workers execute other jobs in the meantime.
+   * \param counter The counter to wait on.
+   */
+  void JobSystem::Wait(const JobCounter& counter) {
+    while (!counter.IsDone()) {
+      if (currentSystem != this || !TryRunOne()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+
+  /**
+   * \brief Gets the number of threads executing jobs, including the thread that created the job system.
+   * \return The number of threads.
+   */
+  uint32_t JobSystem::GetThreadCount() const {
+    return static_cast<uint32_t>(workers.size());
+  }
+
+
+  /**
+   * \brief Gets the index of the calling thread in its job system.
+   * \details The index is in [0, GetThreadCount()), which makes it usable to index per-thread data.
+   * \return The index of the calling thread, or ForeignThread if the thread is not a worker.
+   */
+  uint32_t JobSystem::GetThreadIndex() {
+    return currentIndex;
+  }
+
+
+  /**
+   * \brief Gets a job from the pool of the calling worker, or from the heap for foreign threads.
+   * \return The job, marked as active.
+   */
+  Job* JobSystem::Allocate() {
+    if (currentSystem != this) {
+      Job* job = new Job();
+      job->Heap = true;
+      return job;
+    }
+
+    Worker& worker = *workers[currentIndex];
+    Job* job = &worker.Pool[worker.PoolIndex++ & (PoolCapacity - 1u)];
+    // The pool wrapped around onto a job that is still queued or running, helping until it completes.
+    while (job->Active.load(std::memory_order_acquire)) {
+      if (!TryRunOne()) {
+        std::this_thread::yield();
+      }
+    }
+    job->Active.store(true, std::memory_order_relaxed);
+    return job;
+  }
+
+
+  /**
+   * \brief Queues a job and wakes up a sleeping worker if there is one.
+   * \param job The job to queue.
+   */
+  void JobSystem::Submit(Job* job) {
+    if (currentSystem != this) {
+      std::lock_guard lock(injectionMutex);
+      injection.push_back(job);
+      injectionSize.fetch_add(1u, std::memory_order_release);
+    } else if (!workers[currentIndex]->Queue.Push(job)) {
+      Execute(job);
+      return;
+    }
+
+    // Paired with the sequence in WorkerLoop: either we see the sleeping worker, or it sees the job before sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_seq_cst) != 0u) {
+      wakeEpoch.fetch_add(1u, std::memory_order_seq_cst);
+      wakeEpoch.notify_one();
+    }
+  }
+
+
+  /**
+   * \brief Executes one available job on the calling worker.
+   * \return True if a job was executed.
+   */
+  bool JobSystem::TryRunOne() {
+    Job* job = FindJob();
+    if (job == nullptr) {
+      return false;
+    }
+    Execute(job);
+    return true;
+  }
+
+
+  /**
+   * \brief Finds a job for the calling worker: its own deque first, then the injection queue, then a random victim.
+   * \return The job, or nullptr if none was found.
+   */
+  Job* JobSystem::FindJob() {
+    Worker& self = *workers[currentIndex];
+    if (Job* job = self.Queue.Pop()) {
+      return job;
+    }
+
+    if (injectionSize.load(std::memory_order_acquire) != 0u) {
+      std::lock_guard lock(injectionMutex);
+      if (!injection.empty()) {
+        Job* job = injection.front();
+        injection.pop_front();
+        injectionSize.fetch_sub(1u, std::memory_order_relaxed);
+        return job;
+      }
+    }
+
+    uint32_t& state = self.RandomState;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    const uint32_t count = static_cast<uint32_t>(workers.size());
+    const uint32_t start = state % count;
+    for (uint32_t offset = 0u; offset < count; ++offset) {
+      const uint32_t victim = (start + offset) % count;
+      if (victim == currentIndex) {
+        continue;
+      }
+      if (Job* job = workers[victim]->Queue.Steal()) {
+        return job;
+      }
+    }
+    return nullptr;
+  }
+
+
+  /**
+   * \brief Runs a job, releases it and decrements its counter.
+   * \param job The job to run.
+   */
+  void JobSystem::Execute(Job* job) const {
+    job->Function();
+    job->Function = nullptr;
+
+    JobCounter* counter = job->Counter;
+    if (job->Heap) {
+      delete job;
+    } else {
+      job->Active.store(false, std::memory_order_release);
+    }
+
+    if (counter != nullptr) {
+      counter->pending.fetch_sub(1u, std::memory_order_acq_rel);
+    }
+  }
+
+
+  /**
+   * \brief Main loop of the worker threads.
+   * \param index The index of the worker.
+   */
+  void JobSystem::WorkerLoop(uint32_t index) {
+    currentSystem = this;
+    currentIndex = index;
+
+    while (running.load(std::memory_order_acquire)) {
+      if (TryRunOne()) {
+        continue;
+      }
+
+      // Spinning a little before sleeping since jobs usually come in bursts.
+      bool found = false;
+      for (uint32_t spin = 0u; spin < SpinCount && !found; ++spin) {
+        std::this_thread::yield();
+        found = TryRunOne();
+      }
+      if (found) {
+        continue;
+      }
+
+      sleeping.fetch_add(1u, std::memory_order_seq_cst);
+      const uint32_t epoch = wakeEpoch.load(std::memory_order_seq_cst);
+      if (running.load(std::memory_order_acquire) && !TryRunOne()) {
+        wakeEpoch.wait(epoch, std::memory_order_seq_cst);
+      }
+      sleeping.fetch_sub(1u, std::memory_order_seq_cst);
+    }
+  }
+}
@@ -0,0 +1,195 @@
+/**
+ * @file JobSystem.h
+ * @brief Work-stealing job system running engine work on a pool of worker threads.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WorkStealingQueue.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Counts the jobs that are still pending. A thread can wait on it through JobSystem::Wait().
+   * \details The counter must outlive every job it was given to.
+   */
+  class JobCounter {
+  public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    [[nodiscard]] bool IsDone() const {
+      return pending.load(std::memory_order_acquire) == 0u;
+    }
+
+  private:
+    friend class JobSystem;
+    std::atomic<uint32_t> pending = 0u;
+  };
+
+
+  /**
+   * \brief Unit of work executed by the job system.
+   */
+  struct Job {
+    std::function<void()> Function;
+    JobCounter* Counter = nullptr;
+    /**
+     * \brief True while the job is queued or running, so its pool slot is not reused.
+     */
+    std::atomic<bool> Active = false;
+    /**
+     * \brief True for jobs submitted from a thread that does not belong to the job system, which are allocated on the heap.
+     */
+    bool Heap = false;
+  };
+
+
+  /**
+   * @class JobSystem
+   * @brief Pool of worker threads, each owning a Chase-Lev deque, that steal work from each other when idle.
+   * @details
+   * The thread constructing the job system becomes worker 0 and owns a deque like the other workers, so it executes
+   * jobs (its own or stolen ones) while it waits on a counter instead of blocking. Idle workers sleep on an atomic and
+   * are woken up when new jobs are submitted. Jobs submitted from foreign threads go through a shared injection queue.
+   */
+  class JobSystem {
+  public:
+    /**
+     * \brief Maximum number of queued jobs per worker. Jobs are executed inline when the deque is full.
+     */
+    static constexpr size_t QueueCapacity = 4096u;
+
+    /**
+     * \brief Number of preallocated jobs per worker. Must be a power of two.
+     */
+    static constexpr uint32_t PoolCapacity = 4096u;
+
+    /**
+     * \brief Index returned by GetThreadIndex() for threads that do not belong to a job system.
+     */
+    static constexpr uint32_t ForeignThread = UINT32_MAX;
+
+    JobSystem(uint32_t threadCount = 0u);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+
+    /**
+     * \brief Submits a job.
+     * \tparam Function Type of the job function. Must be callable without arguments.
+     * \param function The function to run on any worker.
+     * \param counter Optional counter incremented now and decremented once the job is done.
+     */
+    template<typename Function>
+    void Run(Function&& function, JobCounter* counter = nullptr) {
+      Job* job = Allocate();
+      job->Function = std::forward<Function>(function);
+      job->Counter = counter;
+      if (counter != nullptr) {
+        counter->pending.fetch_add(1u, std::memory_order_relaxed);
+      }
+      Submit(job);
+    }
+
+
+    /**
+     * \brief Splits a range in chunks processed in parallel, and waits for all of them.
+     * \tparam Function Type of the function. Must be callable as function(uint32_t begin, uint32_t end).
+     * \param count The number of elements in the range.
+     * \param grain The maximum number of elements per chunk.
+     * \param function The function called for every chunk.
+     */
+    template<typename Function>
+    void ParallelFor(uint32_t count, uint32_t grain, Function&& function) {
+      if (count == 0u) {
+        return;
+      }
+      grain = std::max(grain, 1u);
+
+      JobCounter counter;
+      uint32_t begin = 0u;
+      // The last chunk runs on the calling thread, which would otherwise pick up a job right away while waiting.
+      for (; count - begin > grain; begin += grain) {
+        Run([&function, begin, grain] { function(begin, begin + grain); }, &counter);
+      }
+      function(begin, count);
+      Wait(counter);
+    }
+
+
+    /**
+     * \brief Maps chunks of a range in parallel and combines their results.
+     * \details The partial results are combined in order on the calling thread, so the result is deterministic even for non-associative operations such as floating-point sums.
+     * \tparam T The result type.
+     * \tparam Map Type of the map function. Must be callable as T map(uint32_t begin, uint32_t end).
+     * \tparam Combine Type of the combine function. Must be callable as T combine(T, T).
+     * \param count The number of elements in the range.
+     * \param grain The maximum number of elements per chunk.
+     * \param identity The identity value of the combine function.
+     * \param map The function computing the result of a chunk.
+     * \param combine The function combining two results.
+     * \return The combined result.
+     */
+    template<typename T, typename Map, typename Combine>
+    T ParallelReduce(uint32_t count, uint32_t grain, T identity, Map&& map, Combine&& combine) {
+      grain = std::max(grain, 1u);
+      std::vector<T> partials((count + grain - 1u) / grain, identity);
+      ParallelFor(count, grain, [&](uint32_t begin, uint32_t end) {
+        partials[begin / grain] = map(begin, end);
+      });
+
+      T result = identity;
+      for (auto& partial : partials) {
+        result = combine(std::move(result), std::move(partial));
+      }
+      return result;
+    }
+
+
+    void Wait(const JobCounter& counter);
+    [[nodiscard]] uint32_t GetThreadCount() const;
+    [[nodiscard]] static uint32_t GetThreadIndex();
+
+  private:
+    struct Worker {
+      WorkStealingQueue<Job*, QueueCapacity> Queue;
+      std::unique_ptr<Job[]> Pool = std::make_unique<Job[]>(PoolCapacity);
+      uint32_t PoolIndex = 0u;
+      uint32_t RandomState = 0u;
+    };
+
+    Job* Allocate();
+    void Submit(Job* job);
+    bool TryRunOne();
+    Job* FindJob();
+    void Execute(Job* job) const;
+    void WorkerLoop(uint32_t index);
+
+  private:
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> running = true;
+    // Idle workers wait on the epoch, which is incremented when jobs are submitted while some workers sleep.
+    std::atomic<uint32_t> wakeEpoch = 0u;
+    std::atomic<uint32_t> sleeping = 0u;
+    // Jobs submitted from threads that are not workers of this job system.
+    std::mutex injectionMutex;
+    std::deque<Job*> injection;
+    std::atomic<uint32_t> injectionSize = 0u;
+    // The thread creating a job system might already be a worker of another one (e.g. a benchmark inside the engine).
+    JobSystem* previousSystem = nullptr;
+    uint32_t previousIndex = ForeignThread;
+  };
+}
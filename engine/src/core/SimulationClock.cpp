@@ -0,0 +1,125 @@
+/**
+ * @file SimulationClock.cpp
+ * @brief Method implementations for the SimulationClock class.
+ */
+
+#include "SimulationClock.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "../logging/Logger.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Registers a system ticking at a fixed rate, starting from the current simulation time.
+   * \param rate The number of ticks per second.
+   * \param function The function called on every tick with the step in seconds.
+   * \return The identifier of the system, or InvalidSystem if the rate is not positive.
+   */
+  uint32_t SimulationClock::AddSystem(double rate, SystemFunction function) {
+    if (!(rate > 0.0)) {
+      HEIMSKR_ERROR(fmt::format("Invalid simulation rate: {} Hz", rate));
+      return InvalidSystem;
+    }
+
+    System system;
+    system.Id = nextId++;
+    system.Step = 1.0 / rate;
+    system.Start = time;
+    system.Function = std::move(function);
+    (advancing ? added : systems).push_back(std::move(system));
+    return nextId - 1u;
+  }
+
+
+  /**
+   * \brief Unregisters a system. Can be called from a running system, including itself.
+   * \param id The identifier returned by AddSystem().
+   */
+  void SimulationClock::RemoveSystem(uint32_t id) {
+    System* system = FindSystem(id);
+    if (system == nullptr) {
+      return;
+    }
+    // Removed systems are only flagged while advancing and erased once every tick ran, since one of them might be running.
+    system->Removed = true;
+    if (!advancing) {
+      std::erase_if(systems, [](const System& other) { return other.Removed; });
+    }
+  }
+
+
+  /**
+   * \brief Advances the simulation time and runs every tick that became due, in time order.
+   * \param seconds The elapsed real time since the last call.
+   */
+  void SimulationClock::Advance(double seconds) {
+    const double target = time + std::clamp(seconds, 0.0, MaxFrameTime);
+    advancing = true;
+
+    for (;;) {
+      System* next = nullptr;
+      for (auto& system : systems) {
+        if (!system.Removed && system.NextTick() <= target && (next == nullptr || system.NextTick() < next->NextTick())) {
+          next = &system;
+        }
+      }
+      if (next == nullptr) {
+        break;
+      }
+
+      time = next->NextTick();
+      next->Ticks++;
+      next->Function(next->Step);
+    }
+
+    time = target;
+    advancing = false;
+    for (auto& system : added) {
+      systems.push_back(std::move(system));
+    }
+    added.clear();
+    std::erase_if(systems, [](const System& system) { return system.Removed; });
+  }
+
+
+  /**
+   * \brief Gets how far the simulation time is between the last tick of a system and its next one.
+   * \param id The identifier of the system.
+   * \return The interpolation factor in [0, 1], 1 if the system does not exist.
+   */
+  double SimulationClock::GetAlpha(uint32_t id) const {
+    const System* system = FindSystem(id);
+    if (system == nullptr) {
+      return 1.0;
+    }
+    const double last = system->NextTick() - system->Step;
+    return std::clamp((time - last) / system->Step, 0.0, 1.0);
+  }
+
+
+  /**
+   * \brief Gets the simulation time, which only differs from the real time when frames exceed MaxFrameTime.
+   * \return The simulation time in seconds.
+   */
+  double SimulationClock::GetTime() const {
+    return time;
+  }
+
+
+  SimulationClock::System* SimulationClock::FindSystem(uint32_t id) {
+    return const_cast<System*>(std::as_const(*this).FindSystem(id));
+  }
+
+
+  const SimulationClock::System* SimulationClock::FindSystem(uint32_t id) const {
+    for (const auto* list : { &systems, &added }) {
+      auto iterator = std::find_if(list->begin(), list->end(), [id](const System& system) { return system.Id == id && !system.Removed; });
+      if (iterator != list->end()) {
+        return &*iterator;
+      }
+    }
+    return nullptr;
+  }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file SimulationClock.h
+ * @brief Fixed-timestep clock running simulation systems at their own tick rates.
+ */
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace HeimskrEngine {
+  /**
+   * @class SimulationClock
+   * @brief Accumulates the frame time and runs every registered system at its own fixed rate.
+   * @details
+   * Each system ticks with a constant step (e.g. physics at 1 kHz, AI at 10 Hz), independently of the render rate. The
+   * ticks of all the systems are interleaved in time order, so a 10 Hz system always sees the state reached by the
+   * 1 kHz system at the same simulation time. What remains of the frame time after the last tick of a system is
+   * exposed as an interpolation factor, used to blend the rendered transforms between two ticks.
+   */
+  class SimulationClock {
+  public:
+    using SystemFunction = std::function<void(double step)>;
+
+    /**
+     * \brief Maximum frame time simulated in one call to Advance(), in seconds. Beyond that the simulation slows down instead of spiraling with more and more ticks to catch up.
+     */
+    static constexpr double MaxFrameTime = 0.25;
+
+    /**
+     * \brief Identifier returned when a system could not be registered.
+     */
+    static constexpr uint32_t InvalidSystem = UINT32_MAX;
+
+    uint32_t AddSystem(double rate, SystemFunction function);
+    void RemoveSystem(uint32_t id);
+    void Advance(double seconds);
+    [[nodiscard]] double GetAlpha(uint32_t id) const;
+    [[nodiscard]] double GetTime() const;
+
+  private:
+    struct System {
+      uint32_t Id = InvalidSystem;
+      double Step = 0.0;
+      // The tick times are computed from the tick count, so the rounding errors of the steps do not accumulate.
+      double Start = 0.0;
+      uint64_t Ticks = 0u;
+      SystemFunction Function;
+      bool Removed = false;
+
+      [[nodiscard]] double NextTick() const {
+        return Start + static_cast<double>(Ticks + 1u) * Step;
+      }
+    };
+
+    System* FindSystem(uint32_t id);
+    [[nodiscard]] const System* FindSystem(uint32_t id) const;
+
+  private:
+    std::vector<System> systems;
+    // Systems added while advancing, so the vector is not reallocated under a running system.
+    std::vector<System> added;
+    bool advancing = false;
+    double time = 0.0;
+    uint32_t nextId = 0u;
+  };
+}
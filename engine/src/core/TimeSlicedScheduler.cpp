@@ -0,0 +1,133 @@
+/**
+ * @file TimeSlicedScheduler.cpp
+ * @brief Method implementations for the TimeSlicedScheduler class.
+ */
+
+#include "TimeSlicedScheduler.h"
+
+#include <algorithm>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Constructor for the TimeSlicedScheduler class.
+   * \param budgetMs The initial time budget per frame, in milliseconds.
+   */
+  TimeSlicedScheduler::TimeSlicedScheduler(double budgetMs) : budgetMs(std::clamp(budgetMs, MinBudgetMs, MaxBudgetMs)) {}
+
+
+  /**
+   * \brief Schedules a resumable task. It gets its first slice on the next call to Run().
+   * \param name The name of the task, for statistics and debugging.
+   * \param function The function called on every slice, returning true once the task is finished.
+   * \param priority The priority of the task, higher priorities running first in every frame.
+   * \return The handle used to follow the progress of the task or to cancel it.
+   */
+  SlicedTaskHandle TimeSlicedScheduler::Schedule(std::string name, TaskFunction function, int32_t priority) {
+    auto state = std::make_shared<SlicedTaskState>(std::move(name));
+    Task task { state, std::move(function), priority };
+    if (running) {
+      scheduled.push_back(std::move(task));
+    } else {
+      Insert(std::move(task));
+    }
+    return state;
+  }
+
+
+  /**
+   * \brief Runs the pending tasks for at most the current budget. Must be called once per frame from the simulation thread.
+   */
+  void TimeSlicedScheduler::Run() {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(budgetMs));
+    running = true;
+
+    size_t remaining = tasks.size();
+    for (auto& task : tasks) {
+      const auto now = Clock::now();
+      if (now >= end) {
+        break;
+      }
+      if (task.State->IsCancelled()) {
+        remaining--;
+        continue;
+      }
+
+      // Equal share of what is left, so a task finishing early gives its time to the following ones.
+      TimeSlice slice(now + (end - now) / static_cast<Clock::rep>(remaining));
+      slice.Progress = task.State->GetProgress();
+      const bool finished = task.Function(slice);
+      remaining--;
+
+      SlicedTaskState& state = *task.State;
+      const std::chrono::duration<double, std::milli> elapsed = Clock::now() - now;
+      state.elapsedMs.store(state.elapsedMs.load(std::memory_order_relaxed) + elapsed.count(), std::memory_order_relaxed);
+      state.slices.fetch_add(1u, std::memory_order_relaxed);
+      state.progress.store(finished ? 1.0f : std::clamp(slice.Progress, 0.0f, 1.0f), std::memory_order_relaxed);
+      if (finished) {
+        state.done.store(true, std::memory_order_release);
+      }
+    }
+
+    std::erase_if(tasks, [](const Task& task) { return task.State->IsDone() || task.State->IsCancelled(); });
+    running = false;
+    for (auto& task : scheduled) {
+      Insert(std::move(task));
+    }
+    scheduled.clear();
+
+    const std::chrono::duration<double, std::milli> used = Clock::now() - start;
+    usedMs = used.count();
+  }
+
+
+  /**
+   * \brief Adapts the budget to the headroom of the last frames.
+   * \param busyMs The time the frame spent working without the tasks, excluding the time waiting for the vertical blank.
+   * \param targetFrameMs The frame duration to stay under, e.g. the refresh period of the monitor.
+   */
+  void TimeSlicedScheduler::Adapt(double busyMs, double targetFrameMs) {
+    const double headroom = targetFrameMs - busyMs;
+    const double target = std::clamp(headroom * HeadroomShare, MinBudgetMs, MaxBudgetMs);
+    // Moving gradually toward the target, so a single slow frame does not starve the tasks.
+    budgetMs += (target - budgetMs) * 0.1;
+  }
+
+
+  /**
+   * \brief Gets the time budget of the next frame.
+   * \return The budget in milliseconds.
+   */
+  double TimeSlicedScheduler::GetBudgetMs() const {
+    return budgetMs;
+  }
+
+
+  /**
+   * \brief Gets the time the tasks used during the last frame.
+   * \return The used time in milliseconds.
+   */
+  double TimeSlicedScheduler::GetUsedMs() const {
+    return usedMs;
+  }
+
+
+  /**
+   * \brief Adds a task to the pending ones, kept sorted by decreasing priority and in scheduling order for equal priorities.
+   * \param task The task to add.
+   */
+  void TimeSlicedScheduler::Insert(Task&& task) {
+    const auto position = std::find_if(tasks.begin(), tasks.end(), [&task](const Task& other) { return other.Priority < task.Priority; });
+    tasks.insert(position, std::move(task));
+  }
+
+
+  /**
+   * \brief Gets the number of tasks that are not finished.
+   * \return The number of pending tasks.
+   */
+  size_t TimeSlicedScheduler::GetTaskCount() const {
+    return tasks.size() + scheduled.size();
+  }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file TimeSlicedScheduler.h
+ * @brief Scheduler running long background work in slices bounded by a per-frame time budget.
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Time given to a sliced task for one frame. The task works until Expired() and then returns, keeping its state.
+   */
+  class TimeSlice {
+  public:
+    explicit TimeSlice(std::chrono::steady_clock::time_point deadline) : deadline(deadline) {}
+
+    /**
+     * \brief Checks if the task must return to let the frame continue.
+     * \return True once the slice is over.
+     */
+    [[nodiscard]] bool Expired() const {
+      return std::chrono::steady_clock::now() >= deadline;
+    }
+
+    /**
+     * \brief Progress of the task in [0, 1], reported by the task before returning.
+     */
+    float Progress = 0.0f;
+
+  private:
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+
+  /**
+   * \brief Shared state of a sliced task, readable by the code that scheduled it.
+   */
+  class SlicedTaskState {
+  public:
+    explicit SlicedTaskState(std::string name) : name(std::move(name)) {}
+
+    [[nodiscard]] const std::string& GetName() const { return name; }
+    [[nodiscard]] float GetProgress() const { return progress.load(std::memory_order_relaxed); }
+    [[nodiscard]] bool IsDone() const { return done.load(std::memory_order_acquire); }
+    [[nodiscard]] bool IsCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+    /**
+     * \brief Gets the time the task ran so far, summed over every slice.
+     */
+    [[nodiscard]] double GetElapsedMs() const { return elapsedMs.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint32_t GetSlices() const { return slices.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Stops the task before its next slice. A cancelled task is never marked as done.
+     */
+    void Cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+  private:
+    friend class TimeSlicedScheduler;
+    std::string name;
+    std::atomic<float> progress = 0.0f;
+    std::atomic<bool> done = false;
+    std::atomic<bool> cancelled = false;
+    std::atomic<double> elapsedMs = 0.0;
+    std::atomic<uint32_t> slices = 0u;
+  };
+
+  using SlicedTaskHandle = std::shared_ptr<SlicedTaskState>;
+
+
+  /**
+   * @class TimeSlicedScheduler
+   * @brief Runs resumable tasks on the simulation thread, within a time budget per frame.
+   * @details
+   * A task is a function called once per frame with a TimeSlice. It works until the slice expires, saves where it
+   * stopped in its own captures, reports its progress and returns true once finished. Tasks run by decreasing priority,
+   * sharing the budget equally, the unused time of a task going to the next ones. The budget adapts to the headroom of
+   * the frame: it grows while the frame has time left before its target duration and shrinks when the frame is late,
+   * within [MinBudgetMs, MaxBudgetMs].
+   */
+  class TimeSlicedScheduler {
+  public:
+    using TaskFunction = std::function<bool(TimeSlice& slice)>;
+
+    /**
+     * \brief Minimum budget per frame, so the tasks still progress when the frame is late.
+     */
+    static constexpr double MinBudgetMs = 0.25;
+    static constexpr double MaxBudgetMs = 8.0;
+    /**
+     * \brief Share of the measured headroom given to the tasks, the remainder absorbing the frame time variance.
+     */
+    static constexpr double HeadroomShare = 0.5;
+
+    explicit TimeSlicedScheduler(double budgetMs = 2.0);
+
+    SlicedTaskHandle Schedule(std::string name, TaskFunction function, int32_t priority = 0);
+    void Run();
+    void Adapt(double busyMs, double targetFrameMs);
+    [[nodiscard]] double GetBudgetMs() const;
+    [[nodiscard]] double GetUsedMs() const;
+    [[nodiscard]] size_t GetTaskCount() const;
+
+  private:
+    struct Task {
+      SlicedTaskHandle State;
+      TaskFunction Function;
+      int32_t Priority = 0;
+    };
+
+    void Insert(Task&& task);
+
+  private:
+    std::vector<Task> tasks;
+    // Tasks scheduled from a running task, added once the frame's slices are done.
+    std::vector<Task> scheduled;
+    bool running = false;
+    double budgetMs = 2.0;
+    double usedMs = 0.0;
+  };
+}
@@ -0,0 +1,116 @@
+/**
+ * @file WorkStealingQueue.h
+ * @brief Fixed capacity Chase-Lev work-stealing deque.
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace HeimskrEngine {
+  /**
+   * @class WorkStealingQueue
+   * @brief Lock-free deque where the owner thread pushes and pops at the bottom while other threads steal from the top.
+   * @details
+   * Implementation of the Chase-Lev deque with the memory orderings from "Correct and Efficient Work-Stealing for Weak
+   * Memory Models" (Le et al., 2013). The capacity is fixed, so Push() fails instead of growing the buffer.
+   * \tparam T Pointer type stored in the queue. nullptr is returned when the queue is empty or a steal is lost.
+   * \tparam Capacity Maximum number of items. Must be a power of two.
+   */
+  template<typename T, size_t Capacity>
+  class WorkStealingQueue {
+    static_assert(std::is_pointer_v<T>, "The WorkStealingQueue only stores pointers.");
+    static_assert((Capacity & (Capacity - 1)) == 0, "The WorkStealingQueue capacity must be a power of two.");
+    static constexpr int64_t Mask = static_cast<int64_t>(Capacity) - 1;
+
+  public:
+    WorkStealingQueue() = default;
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+
+    /**
+     * \brief Pushes an item at the bottom of the queue. Must only be called by the owner thread.
+     * \param item The item to push.
+     * \return False if the queue is full.
+     */
+    bool Push(T item) {
+      const int64_t b = bottom.load(std::memory_order_relaxed);
+      const int64_t t = top.load(std::memory_order_acquire);
+      if (b - t > Mask) {
+        return false;
+      }
+      buffer[b & Mask].store(item, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+
+    /**
+     * \brief Pops the most recently pushed item. Must only be called by the owner thread.
+     * \return The item, or nullptr if the queue is empty.
+     */
+    T Pop() {
+      const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+      bottom.store(b, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t t = top.load(std::memory_order_relaxed);
+
+      if (t > b) {
+        // The queue was empty.
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+      }
+
+      T item = buffer[b & Mask].load(std::memory_order_relaxed);
+      if (t == b) {
+        // Last item, racing against the thieves for it.
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+          item = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+      }
+      return item;
+    }
+
+
+    /**
+     * \brief Steals the oldest item of the queue. Can be called from any thread.
+     * \return The item, or nullptr if the queue is empty or another thread won the race.
+     */
+    T Steal() {
+      int64_t t = top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const int64_t b = bottom.load(std::memory_order_acquire);
+
+      if (t >= b) {
+        return nullptr;
+      }
+      T item = buffer[t & Mask].load(std::memory_order_relaxed);
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+      }
+      return item;
+    }
+
+
+    /**
+     * \brief Gets an approximation of the number of items in the queue.
+     * \return The number of items at the time of the call.
+     */
+    [[nodiscard]] size_t Size() const {
+      const int64_t b = bottom.load(std::memory_order_relaxed);
+      const int64_t t = top.load(std::memory_order_relaxed);
+      return b > t ? static_cast<size_t>(b - t) : 0u;
+    }
+
+  private:
+    // Top and bottom are on separate cache lines since they are written by different threads.
+    alignas(64) std::atomic<int64_t> top = 0;
+    alignas(64) std::atomic<int64_t> bottom = 0;
+    alignas(64) std::array<std::atomic<T>, Capacity> buffer = {};
+  };
+}
@@ -4,8 +4,9 @@
  */
 
 #pragma once
-#include <string>
+#include <string_view>
 
+#include "../common/NameTable.h"
 #include "../graphics/buffers/Mesh.h"
 #include "ECS.h"
 
@@ -22,6 +23,24 @@ namespace HeimskrEngine {
   };
 
 
+  /**
+   * \brief Component making the renderer interpolate the transform of an entity between two fixed updates.
+   * \details The previous transform is saved before every fixed update, and the rendered transform is blended between it and the current one. Attach it with the current transform to avoid interpolating from the origin.
+   */
+  struct InterpolatedTransformComponent {
+    InterpolatedTransformComponent() = default;
+    InterpolatedTransformComponent(const Transform3D& previous) : Previous(previous) {}
+    InterpolatedTransformComponent(const InterpolatedTransformComponent&) = default;
+    virtual ~InterpolatedTransformComponent() = default;
+
+    Transform3D Previous;
+    /**
+     * \brief True if the transform was blended by the last extraction, so the final transform is extracted once the entity stops.
+     */
+    bool Moving = false;
+  };
+
+
   /**
    * \brief Component for 3D cameras.
    */
@@ -36,14 +55,24 @@ namespace HeimskrEngine {
 
   /**
    * \brief Base component for Entt components.
-   *
+   * \details The name is interned in the NameTable, so the component only stores its 32 bits identifier.
+   * It has no virtual destructor to keep it at 4 bytes per entity.
    */
   struct EnttComponent {
     EnttComponent() = default;
+    EnttComponent(std::string_view name) : Name(NameTable::GetInstance().Intern(name)) {}
     EnttComponent(const EnttComponent&) = default;
-    virtual ~EnttComponent() = default;
+    ~EnttComponent() = default;
+
+    /**
+     * \brief Gets the characters of the entity's name.
+     * \return The interned name.
+     */
+    [[nodiscard]] std::string_view GetName() const {
+      return NameTable::GetInstance().Get(Name);
+    }
 
-    std::string Name = "Undefined";
+    NameID Name = UndefinedName;
   };
 
 
@@ -56,5 +85,31 @@ namespace HeimskrEngine {
     virtual ~MeshComponent() = default;
 
     Mesh3D Mesh;
+    uint32_t Material = 0u;
+    /**
+     * \brief Drawn after the opaque meshes, back to front and blended.
+     */
+    bool Transparent = false;
   };
+
+
+  /**
+   * \brief Component holding the slot of a mesh entity inside the renderer's instance buffer.
+   * \details Attached and removed by the render extraction stage, it should not be attached manually.
+   */
+  struct RenderInstanceComponent {
+    RenderInstanceComponent() = default;
+    RenderInstanceComponent(uint32_t slot) : Slot(slot) {}
+    RenderInstanceComponent(const RenderInstanceComponent&) = default;
+    virtual ~RenderInstanceComponent() = default;
+
+    uint32_t Slot = 0u;
+  };
+
+
+  /**
+   * \brief Tag component marking an entity whose transform changed since the last render extraction.
+   * \details Kept empty (no virtual destructor) so entt does not allocate storage for its instances.
+   */
+  struct DirtyTransformComponent {};
 }
@@ -4,10 +4,30 @@
  */
 
 #pragma once
+#include <type_traits>
 
 #include "ECS.h"
 
 namespace HeimskrEngine {
+  struct TransformComponent;
+  struct MeshComponent;
+  struct EnttComponent;
+
+  /**
+   * \brief Tells if the changes of a component are tracked through the registry signals, by the render extraction stage or the name index.
+   * \details A tracked component is only handed out as const outside of Entity::Patch(), so a change that would not be seen by the rendering, the culling, the spatial queries or the name lookups does not compile.
+   */
+  template<typename T>
+  inline constexpr bool IsTrackedComponent = std::is_same_v<T, TransformComponent> || std::is_same_v<T, MeshComponent> || std::is_same_v<T, EnttComponent>;
+
+
+  /**
+   * \brief Type of a component handed out by Entity::Get() and the entity views, const for the tracked components.
+   */
+  template<typename T>
+  using ComponentAccess = std::conditional_t<IsTrackedComponent<T>, const T, T>;
+
+
   /**
    * \class Entity
    * \brief Wrapper class for entities in the ECS framework.
@@ -55,10 +75,10 @@ namespace HeimskrEngine {
      * \tparam T Type of the component to attach.
      * \tparam Args Variadic template arguments for component constructor.
      * \param args Constructor arguments for the component.
-     * \return Reference to the attached component.
+     * \return Reference to the attached component, const for the tracked components (see IsTrackedComponent).
      */
     template<typename T, typename ... Args>
-    T& Attach(Args&&... args) {
+    ComponentAccess<T>& Attach(Args&&... args) {
       return registry->get_or_emplace<T>(entity, std::forward<Args>(args)...);
     }
 
@@ -101,13 +121,27 @@ namespace HeimskrEngine {
     /**
      * \brief Gets a component from the entity.
      * \tparam T Type of the component to get.
-     * \return Reference to the component.
+     * \return Reference to the component, const for the tracked components (see IsTrackedComponent), which are modified through Patch().
      */
     template<typename T>
-    T& Get() const {
+    ComponentAccess<T>& Get() const {
       return registry->get<T>(entity);
     }
 
+
+    /**
+     * \brief Modifies a component in place and notifies the registry of the change.
+     * \details Unlike Get(), this triggers the on_update signals of the component, which is how systems such as the render extraction stage know what changed.
+     * \tparam T Type of the component to modify.
+     * \tparam Func Types of the functions to apply to the component.
+     * \param func Functions taking a reference to the component.
+     * \return Reference to the component, const for the tracked components (see IsTrackedComponent).
+     */
+    template<typename T, typename ... Func>
+    ComponentAccess<T>& Patch(Func&&... func) const {
+      return registry->patch<T>(entity, std::forward<Func>(func)...);
+    }
+
   protected:
     entt::registry* registry = nullptr;
     entt::entity entity = entt::null;
@@ -0,0 +1,169 @@
+/**
+ * @file NameIndex.cpp
+ * @brief Implementation of the NameIndex class.
+ */
+
+#include "NameIndex.h"
+
+#include <algorithm>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Destructor for the NameIndex class.
+   */
+  NameIndex::~NameIndex() {
+    Disconnect();
+  }
+
+
+  /**
+   * \brief Connects the index to the registry signals and indexes the already named entities.
+   * \param registry The scene registry to index.
+   */
+  void NameIndex::Connect(entt::registry& registry) {
+    Disconnect();
+    this->registry = &registry;
+
+    registry.view<EnttComponent>().each([this](entt::entity entity, const EnttComponent& component) {
+      Insert(component.Name, entity);
+    });
+
+    registry.on_construct<EnttComponent>().connect<&NameIndex::OnConstruct>(this);
+    registry.on_update<EnttComponent>().connect<&NameIndex::OnUpdate>(this);
+    registry.on_destroy<EnttComponent>().connect<&NameIndex::OnDestroy>(this);
+  }
+
+
+  /**
+   * \brief Disconnects the index from the registry signals and clears it.
+   */
+  void NameIndex::Disconnect() {
+    if (registry == nullptr) {
+      return;
+    }
+    registry->on_construct<EnttComponent>().disconnect(this);
+    registry->on_update<EnttComponent>().disconnect(this);
+    registry->on_destroy<EnttComponent>().disconnect(this);
+    registry = nullptr;
+    entities.clear();
+    names.clear();
+  }
+
+
+  /**
+   * \brief Finds the first entity with the given name, i.e. the one named first among those still carrying it.
+   * \param name The identifier of the name.
+   * \return The entity, or entt::null if no entity has this name.
+   */
+  entt::entity NameIndex::Find(NameID name) const {
+    const auto iterator = entities.find(name);
+    if (iterator == entities.end() || iterator->second.empty()) {
+      return entt::null;
+    }
+    return iterator->second.front();
+  }
+
+
+  /**
+   * \brief Finds the first entity with the given name.
+   * \param name The characters of the name. It is not interned if unknown.
+   * \return The entity, or entt::null if no entity has this name.
+   */
+  entt::entity NameIndex::Find(std::string_view name) const {
+    const NameID id = NameTable::GetInstance().Find(name);
+    if (id == InvalidName) {
+      return entt::null;
+    }
+    return Find(id);
+  }
+
+
+  /**
+   * \brief Finds every entity with the given name, in the order they were named.
+   * \param name The identifier of the name.
+   * \return The entities, valid until the next change to the index.
+   */
+  std::span<const entt::entity> NameIndex::FindAll(NameID name) const {
+    const auto iterator = entities.find(name);
+    if (iterator == entities.end()) {
+      return {};
+    }
+    return iterator->second;
+  }
+
+
+  /**
+   * \brief Indexes an entity that received an EnttComponent.
+   * \param registry The registry that emitted the signal.
+   * \param entity The named entity.
+   */
+  void NameIndex::OnConstruct(entt::registry& registry, entt::entity entity) {
+    Insert(registry.get<EnttComponent>(entity).Name, entity);
+  }
+
+
+  /**
+   * \brief Re-indexes an entity whose EnttComponent was patched or replaced.
+   * \param registry The registry that emitted the signal.
+   * \param entity The renamed entity.
+   */
+  void NameIndex::OnUpdate(entt::registry& registry, entt::entity entity) {
+    const NameID name = registry.get<EnttComponent>(entity).Name;
+    const auto iterator = names.find(entity);
+    if (iterator != names.end()) {
+      if (iterator->second == name) {
+        return;
+      }
+      Erase(iterator->second, entity);
+    }
+    Insert(name, entity);
+  }
+
+
+  /**
+   * \brief Removes an entity that lost its EnttComponent from the index.
+   * \param registry The registry that emitted the signal.
+   * \param entity The entity that lost its name.
+   */
+  void NameIndex::OnDestroy(entt::registry&, entt::entity entity) {
+    // Using the indexed name in case the component was modified without being patched.
+    const auto iterator = names.find(entity);
+    if (iterator != names.end()) {
+      Erase(iterator->second, entity);
+    }
+  }
+
+
+  /**
+   * \brief Adds an entity to the entities of a name.
+   * \param name The identifier of the name.
+   * \param entity The entity to add.
+   */
+  void NameIndex::Insert(NameID name, entt::entity entity) {
+    entities[name].push_back(entity);
+    names[entity] = name;
+  }
+
+
+  /**
+   * \brief Removes an entity from the entities of a name.
+   * \param name The identifier of the name.
+   * \param entity The entity to remove.
+   */
+  void NameIndex::Erase(NameID name, entt::entity entity) {
+    names.erase(entity);
+    const auto iterator = entities.find(name);
+    if (iterator == entities.end()) {
+      return;
+    }
+    auto& named = iterator->second;
+    // Erased in order, so Find() keeps returning the first entity given the name. Few entities share a name.
+    const auto position = std::find(named.begin(), named.end(), entity);
+    if (position != named.end()) {
+      named.erase(position);
+    }
+    if (named.empty()) {
+      entities.erase(iterator);
+    }
+  }
+}
@@ -0,0 +1,47 @@
+/**
+ * @file NameIndex.h
+ * @brief Hash index from interned entity names to the entities carrying them.
+ */
+
+#pragma once
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ECS.h"
+
+namespace HeimskrEngine {
+  /**
+   * @class NameIndex
+   * @brief Maps the NameID of every EnttComponent to its entities, kept up to date through the registry signals.
+   * @details Name lookups become a hash lookup instead of a full registry scan. Entity::Get() hands out the
+   * EnttComponent as const, so a rename goes through Entity::Patch() (or a replace) and re-indexes the entity.
+   */
+  class NameIndex {
+  public:
+    NameIndex() = default;
+    ~NameIndex();
+
+    void Connect(entt::registry& registry);
+    void Disconnect();
+
+    [[nodiscard]] entt::entity Find(NameID name) const;
+    [[nodiscard]] entt::entity Find(std::string_view name) const;
+    [[nodiscard]] std::span<const entt::entity> FindAll(NameID name) const;
+
+  private:
+    void OnConstruct(entt::registry& registry, entt::entity entity);
+    void OnUpdate(entt::registry& registry, entt::entity entity);
+    void OnDestroy(entt::registry& registry, entt::entity entity);
+
+    void Insert(NameID name, entt::entity entity);
+    void Erase(NameID name, entt::entity entity);
+
+  private:
+    entt::registry* registry = nullptr;
+    std::unordered_map<NameID, std::vector<entt::entity>> entities;
+    // The on_update signal is emitted after the change, so the previous name of every entity is kept to re-index it.
+    std::unordered_map<entt::entity, NameID> names;
+  };
+}
@@ -6,5 +6,28 @@
 #pragma once
 
 #include <assimp/quaternion.h>
+#include <assimp/vector2.h>
+#include <assimp/vector3.h>
 
 #include "./buffers/Mesh.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Converts an Assimp 3D vector to a GLM vector.
+   * \param vector The Assimp vector.
+   * \return The GLM vector.
+   */
+  inline glm::vec3 ToGLM(const aiVector3D& vector) {
+    return glm::vec3(vector.x, vector.y, vector.z);
+  }
+
+
+  /**
+   * \brief Converts an Assimp quaternion to a GLM quaternion.
+   * \param quaternion The Assimp quaternion.
+   * \return The GLM quaternion.
+   */
+  inline glm::quat ToGLM(const aiQuaternion& quaternion) {
+    return glm::quat(quaternion.w, quaternion.x, quaternion.y, quaternion.z);
+  }
+}
@@ -0,0 +1,420 @@
+/**
+ * @file BoundingVolumeHierarchy.cpp
+ * @brief Implementation of the BoundingVolumeHierarchy class.
+ */
+
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../core/TimeSlicedScheduler.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Adds an object or updates its box.
+   * \details A new object is tested by the queries right away, but only enters the tree with the next build. A moved object only updates the tree with the next Refit().
+   * \param id The id of the object, ids should be dense since they index an array.
+   * \param box The box of the object in world space.
+   */
+  void BoundingVolumeHierarchy::Set(uint32_t id, const BoundingBox& box) {
+    if (id >= proxies.size()) {
+      proxies.resize(id + 1u);
+    }
+    Proxy& proxy = proxies[id];
+    proxy.Min = box.Min();
+    proxy.Max = box.Max();
+    if (proxy.State == ProxyState::Absent) {
+      proxy.State = ProxyState::Pending;
+      proxy.PendingIndex = static_cast<uint32_t>(pending.size());
+      pending.push_back(id);
+    } else if (proxy.State == ProxyState::Tree) {
+      dirty = true;
+    }
+  }
+
+
+  /**
+   * \brief Removes an object. Its slot in the tree is skipped until the next build.
+   * \param id The id of the object.
+   */
+  void BoundingVolumeHierarchy::Remove(uint32_t id) {
+    if (id >= proxies.size()) {
+      return;
+    }
+    Proxy& proxy = proxies[id];
+    if (proxy.State == ProxyState::Pending) {
+      RemovePending(id);
+    } else if (proxy.State == ProxyState::Tree) {
+      staleItems++;
+      dirty = true;
+    }
+    proxy.State = ProxyState::Absent;
+  }
+
+
+  /**
+   * \brief Recomputes the boxes of the nodes from the boxes of their objects, if any object moved, and measures the cost of the tree.
+   */
+  void BoundingVolumeHierarchy::Refit() {
+    if (!dirty || nodes.empty()) {
+      return;
+    }
+    dirty = false;
+
+    float sum = 0.0f;
+    // The children come after their parent, so a reverse pass refits them first.
+    for (size_t index = nodes.size(); index-- > 0u;) {
+      Node& node = nodes[index];
+      if (node.Count == 0u) {
+        const Node& left = nodes[node.First];
+        const Node& right = nodes[node.First + 1u];
+        node.Min = glm::min(left.Min, right.Min);
+        node.Max = glm::max(left.Max, right.Max);
+        sum += TraversalCost * Area(node.Min, node.Max);
+        continue;
+      }
+
+      node.Min = glm::vec3(FLT_MAX);
+      node.Max = glm::vec3(-FLT_MAX);
+      for (uint32_t item = node.First; item < node.First + node.Count; ++item) {
+        const Proxy& proxy = proxies[items[item]];
+        if (proxy.State == ProxyState::Tree) {
+          node.Min = glm::min(node.Min, proxy.Min);
+          node.Max = glm::max(node.Max, proxy.Max);
+        }
+      }
+      sum += IntersectionCost * static_cast<float>(node.Count) * Area(node.Min, node.Max);
+    }
+
+    const float rootArea = Area(nodes[0].Min, nodes[0].Max);
+    cost = rootArea > 0.0f ? sum / rootArea : 0.0f;
+  }
+
+
+  /**
+   * \brief Tells if the tree degraded enough, or if enough objects were added or removed since the last build, to be rebuilt.
+   * \return True if the tree should be rebuilt.
+   */
+  bool BoundingVolumeHierarchy::NeedsRebuild() const {
+    if (building) {
+      return false;
+    }
+    if (nodes.empty()) {
+      return !pending.empty();
+    }
+    const auto changes = static_cast<float>(pending.size() + staleItems);
+    if (changes > std::max(static_cast<float>(MinRebuildChanges), RebuildChangeRatio * static_cast<float>(items.size()))) {
+      return true;
+    }
+    return cost > builtCost * RebuildCostRatio;
+  }
+
+
+  /**
+   * \brief Rebuilds the whole tree at once, including the pending objects.
+   */
+  void BoundingVolumeHierarchy::Build() {
+    CancelRebuild();
+    Step(nullptr);
+  }
+
+
+  /**
+   * \brief Rebuilds the tree over several calls, each returning when its time slice expires. The queries use the old tree until the new one is finished.
+   * \details The objects added or removed while the tree is rebuilt are handled as usual, the moved ones being refitted once the new tree replaces the old one.
+   * \param slice The time given to the rebuild.
+   * \return True once the new tree replaced the old one.
+   */
+  bool BoundingVolumeHierarchy::Rebuild(TimeSlice& slice) {
+    return Step(&slice);
+  }
+
+
+  /**
+   * \brief Drops the tree being rebuilt, if any.
+   */
+  void BoundingVolumeHierarchy::CancelRebuild() {
+    building = false;
+    buildNodes.clear();
+    buildItems.clear();
+    buildTasks.clear();
+  }
+
+
+  /**
+   * \brief Casts a ray against the boxes of the objects.
+   * \details The children are visited closest first, and the nodes further than the closest hit found so far are skipped.
+   * \param origin The origin of the ray.
+   * \param direction The direction of the ray, not necessarily normalized, the distances being in multiples of it.
+   * \param maxDistance The maximum distance of the hits.
+   * \param hit Receives the closest hit.
+   * \return True if any box is hit.
+   */
+  bool BoundingVolumeHierarchy::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const {
+    const glm::vec3 inverse = glm::vec3(1.0f) / direction;
+    // Distance where the ray enters a box, or FLT_MAX if it misses it within the closest hit.
+    auto enter = [&](const glm::vec3& min, const glm::vec3& max, float limit) {
+      const glm::vec3 toMin = (min - origin) * inverse;
+      const glm::vec3 toMax = (max - origin) * inverse;
+      const glm::vec3 first = glm::min(toMin, toMax);
+      const glm::vec3 last = glm::max(toMin, toMax);
+      const float entry = std::max({ first.x, first.y, first.z, 0.0f });
+      const float exit = std::min({ last.x, last.y, last.z, limit });
+      return entry <= exit ? entry : FLT_MAX;
+    };
+
+    bool found = false;
+    float closest = maxDistance;
+    auto test = [&](uint32_t id) {
+      const float distance = enter(proxies[id].Min, proxies[id].Max, closest);
+      if (distance != FLT_MAX && (!found || distance < closest)) {
+        found = true;
+        closest = distance;
+        hit = { id, distance };
+      }
+    };
+
+    if (!nodes.empty() && enter(nodes[0].Min, nodes[0].Max, closest) != FLT_MAX) {
+      std::pair<uint32_t, float> stack[MaxDepth + 1u];
+      uint32_t size = 0u;
+      stack[size++] = { 0u, 0.0f };
+      while (size != 0u) {
+        const auto [index, distance] = stack[--size];
+        if (found && distance > closest) {
+          continue;
+        }
+        const Node& node = nodes[index];
+        if (node.Count != 0u) {
+          for (uint32_t item = node.First; item < node.First + node.Count; ++item) {
+            if (proxies[items[item]].State == ProxyState::Tree) {
+              test(items[item]);
+            }
+          }
+          continue;
+        }
+
+        float left = enter(nodes[node.First].Min, nodes[node.First].Max, closest);
+        float right = enter(nodes[node.First + 1u].Min, nodes[node.First + 1u].Max, closest);
+        uint32_t closer = node.First;
+        uint32_t further = node.First + 1u;
+        if (right < left) {
+          std::swap(left, right);
+          std::swap(closer, further);
+        }
+        if (right != FLT_MAX) {
+          stack[size++] = { further, right };
+        }
+        if (left != FLT_MAX) {
+          stack[size++] = { closer, left };
+        }
+      }
+    }
+
+    for (const uint32_t id : pending) {
+      test(id);
+    }
+    return found;
+  }
+
+
+  /**
+   * \brief Builds the new tree until every task is done or the slice expires, starting the build if needed.
+   * \param slice The time given to the build, or nullptr to build it at once.
+   * \return True once the new tree replaced the old one.
+   */
+  bool BoundingVolumeHierarchy::Step(TimeSlice* slice) {
+    if (!building) {
+      building = true;
+      buildNodes.clear();
+      buildTasks.clear();
+      buildItems.clear();
+      builtItems = 0u;
+      for (uint32_t id = 0u; id < proxies.size(); ++id) {
+        if (proxies[id].State != ProxyState::Absent) {
+          buildItems.push_back(id);
+        }
+      }
+      if (!buildItems.empty()) {
+        buildNodes.emplace_back();
+        buildTasks.push_back({ 0u, 0u, static_cast<uint32_t>(buildItems.size()), 0u });
+      }
+    }
+
+    // Checking the clock every few nodes only, the nodes near the leaves being quick to split.
+    constexpr uint32_t nodesPerCheck = 32u;
+    for (uint32_t split = 1u; !buildTasks.empty(); ++split) {
+      const BuildTask task = buildTasks.back();
+      buildTasks.pop_back();
+      Split(task);
+      if (slice != nullptr && split % nodesPerCheck == 0u && slice->Expired()) {
+        slice->Progress = buildItems.empty() ? 1.0f : static_cast<float>(builtItems) / static_cast<float>(buildItems.size());
+        return false;
+      }
+    }
+
+    Finish();
+    return true;
+  }
+
+
+  /**
+   * \brief Splits a node of the tree being built with the surface area heuristic, or makes it a leaf.
+   * \param task The node and the range of its objects.
+   */
+  void BoundingVolumeHierarchy::Split(const BuildTask& task) {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+    glm::vec3 centroidMin = glm::vec3(FLT_MAX);
+    glm::vec3 centroidMax = glm::vec3(-FLT_MAX);
+    for (uint32_t item = task.Begin; item < task.End; ++item) {
+      const Proxy& proxy = proxies[buildItems[item]];
+      min = glm::min(min, proxy.Min);
+      max = glm::max(max, proxy.Max);
+      const glm::vec3 centroid = (proxy.Min + proxy.Max) * 0.5f;
+      centroidMin = glm::min(centroidMin, centroid);
+      centroidMax = glm::max(centroidMax, centroid);
+    }
+    buildNodes[task.Node].Min = min;
+    buildNodes[task.Node].Max = max;
+
+    const uint32_t count = task.End - task.Begin;
+    auto makeLeaf = [&] {
+      buildNodes[task.Node].First = task.Begin;
+      buildNodes[task.Node].Count = count;
+      builtItems += count;
+    };
+    if (count <= MinLeafSize || task.Depth >= MaxDepth) {
+      makeLeaf();
+      return;
+    }
+
+    // Sweeping the bins of every axis for the split minimizing the areas of the children weighted by their number of objects.
+    float bestCost = FLT_MAX;
+    uint32_t bestAxis = 0u;
+    uint32_t bestBin = 0u;
+    for (uint32_t axis = 0u; axis < 3u; ++axis) {
+      const float extent = centroidMax[axis] - centroidMin[axis];
+      if (extent <= 0.0f) {
+        continue;
+      }
+      const float scale = static_cast<float>(Bins) / extent;
+      uint32_t binCounts[Bins] = {};
+      glm::vec3 binMin[Bins];
+      glm::vec3 binMax[Bins];
+      std::fill(std::begin(binMin), std::end(binMin), glm::vec3(FLT_MAX));
+      std::fill(std::begin(binMax), std::end(binMax), glm::vec3(-FLT_MAX));
+      for (uint32_t item = task.Begin; item < task.End; ++item) {
+        const Proxy& proxy = proxies[buildItems[item]];
+        const float centroid = (proxy.Min[axis] + proxy.Max[axis]) * 0.5f;
+        const uint32_t bin = std::min(static_cast<uint32_t>((centroid - centroidMin[axis]) * scale), Bins - 1u);
+        binCounts[bin]++;
+        binMin[bin] = glm::min(binMin[bin], proxy.Min);
+        binMax[bin] = glm::max(binMax[bin], proxy.Max);
+      }
+
+      // Cost of the left side of every split, accumulated from the first bin, then combined with the right side from the last bin.
+      float leftCosts[Bins - 1u];
+      glm::vec3 accumulatedMin = glm::vec3(FLT_MAX);
+      glm::vec3 accumulatedMax = glm::vec3(-FLT_MAX);
+      uint32_t accumulatedCount = 0u;
+      for (uint32_t bin = 0u; bin < Bins - 1u; ++bin) {
+        accumulatedMin = glm::min(accumulatedMin, binMin[bin]);
+        accumulatedMax = glm::max(accumulatedMax, binMax[bin]);
+        accumulatedCount += binCounts[bin];
+        leftCosts[bin] = accumulatedCount == 0u ? FLT_MAX : static_cast<float>(accumulatedCount) * Area(accumulatedMin, accumulatedMax);
+      }
+      accumulatedMin = glm::vec3(FLT_MAX);
+      accumulatedMax = glm::vec3(-FLT_MAX);
+      accumulatedCount = 0u;
+      for (uint32_t bin = Bins - 1u; bin > 0u; --bin) {
+        accumulatedMin = glm::min(accumulatedMin, binMin[bin]);
+        accumulatedMax = glm::max(accumulatedMax, binMax[bin]);
+        accumulatedCount += binCounts[bin];
+        if (accumulatedCount == 0u || leftCosts[bin - 1u] == FLT_MAX) {
+          continue;
+        }
+        const float splitCost = leftCosts[bin - 1u] + static_cast<float>(accumulatedCount) * Area(accumulatedMin, accumulatedMax);
+        if (splitCost < bestCost) {
+          bestCost = splitCost;
+          bestAxis = axis;
+          bestBin = bin;
+        }
+      }
+    }
+
+    uint32_t middle = task.Begin + count / 2u;
+    if (bestCost != FLT_MAX) {
+      const float leafCost = IntersectionCost * static_cast<float>(count) * Area(min, max);
+      if (count <= MaxLeafSize && TraversalCost * Area(min, max) + IntersectionCost * bestCost >= leafCost) {
+        makeLeaf();
+        return;
+      }
+      const float scale = static_cast<float>(Bins) / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+      const auto* split = std::partition(buildItems.data() + task.Begin, buildItems.data() + task.End, [&](uint32_t id) {
+        const float centroid = (proxies[id].Min[bestAxis] + proxies[id].Max[bestAxis]) * 0.5f;
+        return std::min(static_cast<uint32_t>((centroid - centroidMin[bestAxis]) * scale), Bins - 1u) < bestBin;
+      });
+      middle = static_cast<uint32_t>(split - buildItems.data());
+    } else if (count <= MaxLeafSize) {
+      // Every centroid at the same place, no split separates the objects.
+      makeLeaf();
+      return;
+    }
+
+    const auto left = static_cast<uint32_t>(buildNodes.size());
+    buildNodes.emplace_back();
+    buildNodes.emplace_back();
+    buildNodes[task.Node].First = left;
+    buildNodes[task.Node].Count = 0u;
+    buildTasks.push_back({ left + 1u, middle, task.End, task.Depth + 1u });
+    buildTasks.push_back({ left, task.Begin, middle, task.Depth + 1u });
+  }
+
+
+  /**
+   * \brief Replaces the tree with the one just built, then refits it with the boxes of the objects that moved during the build.
+   */
+  void BoundingVolumeHierarchy::Finish() {
+    nodes.swap(buildNodes);
+    items.swap(buildItems);
+    CancelRebuild();
+
+    staleItems = 0u;
+    for (const uint32_t id : items) {
+      Proxy& proxy = proxies[id];
+      if (proxy.State == ProxyState::Pending) {
+        RemovePending(id);
+        proxy.State = ProxyState::Tree;
+      } else if (proxy.State == ProxyState::Absent) {
+        staleItems++;
+      }
+    }
+
+    dirty = true;
+    cost = 0.0f;
+    Refit();
+    builtCost = cost;
+  }
+
+
+  /**
+   * \brief Removes an object from the pending list.
+   * \param id The id of the pending object.
+   */
+  void BoundingVolumeHierarchy::RemovePending(uint32_t id) {
+    const uint32_t index = proxies[id].PendingIndex;
+    pending[index] = pending.back();
+    proxies[pending[index]].PendingIndex = index;
+    pending.pop_back();
+  }
+
+
+  /**
+   * \brief Computes the surface area of a box, 0 for an empty box.
+   */
+  float BoundingVolumeHierarchy::Area(const glm::vec3& min, const glm::vec3& max) {
+    const glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+}
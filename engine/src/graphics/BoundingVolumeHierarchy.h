@@ -0,0 +1,318 @@
+/**
+ * @file BoundingVolumeHierarchy.h
+ * @brief Dynamic bounding volume hierarchy over the world bounds of the rendered instances.
+ */
+
+#pragma once
+#include <cfloat>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "utilities/Bounds.h"
+
+namespace HeimskrEngine {
+  class TimeSlice;
+
+  /**
+   * \brief Closest box hit by a ray, see BoundingVolumeHierarchy::Raycast().
+   */
+  struct RayHit {
+    uint32_t Id = 0u;
+    /**
+     * \brief Distance along the ray direction where the ray enters the box, 0 if it starts inside.
+     */
+    float Distance = 0.0f;
+  };
+
+
+  /**
+   * @class BoundingVolumeHierarchy
+   * @brief Binary tree of axis-aligned boxes over a set of objects identified by a dense id.
+   * @details
+   * The tree is built top-down with the surface area heuristic over binned centroids. When objects move, their boxes
+   * are only updated and Refit() recomputes the node boxes bottom-up in a single pass over the nodes, keeping the
+   * topology. Refitting degrades the tree as objects drift away from where it was built, so the cost of the tree is
+   * measured at every refit and NeedsRebuild() tells when it got too far from the cost of the last build, or when too
+   * many objects were added or removed since. The rebuild can run in slices over several frames (Rebuild()), the old
+   * tree serving the queries until the new one replaces it. Objects added since the last build are kept in a pending
+   * list, tested one by one by the queries until the next build.
+   * The nodes are stored in a flat array where the children of a node always come after it, in consecutive pairs.
+   */
+  class BoundingVolumeHierarchy {
+  public:
+    /**
+     * \brief Number of objects under which a node is always a leaf.
+     */
+    static constexpr uint32_t MinLeafSize = 2u;
+    /**
+     * \brief Number of objects over which a node is always split, even when the heuristic prefers a leaf.
+     */
+    static constexpr uint32_t MaxLeafSize = 8u;
+    /**
+     * \brief Maximum depth of the tree, which bounds the traversal stacks.
+     */
+    static constexpr uint32_t MaxDepth = 48u;
+    static constexpr uint32_t Bins = 16u;
+    /**
+     * \brief Relative costs of visiting a node and of testing an object, for the surface area heuristic.
+     */
+    static constexpr float TraversalCost = 1.0f;
+    static constexpr float IntersectionCost = 1.0f;
+    /**
+     * \brief Ratio between the cost of the refitted tree and the cost of its build over which it is rebuilt.
+     */
+    static constexpr float RebuildCostRatio = 1.5f;
+    /**
+     * \brief Share of the objects added or removed since the last build over which the tree is rebuilt.
+     */
+    static constexpr float RebuildChangeRatio = 0.1f;
+    static constexpr uint32_t MinRebuildChanges = 64u;
+
+    void Set(uint32_t id, const BoundingBox& box);
+    void Remove(uint32_t id);
+    void Refit();
+    void Build();
+    bool Rebuild(TimeSlice& slice);
+    void CancelRebuild();
+
+    [[nodiscard]] bool NeedsRebuild() const;
+    [[nodiscard]] bool IsRebuilding() const { return building; }
+    [[nodiscard]] bool HasTree() const { return !nodes.empty(); }
+    /**
+     * \brief Gets the cost of the tree relative to the cost it had when built, 1 right after a build.
+     */
+    [[nodiscard]] float GetQuality() const { return builtCost > 0.0f ? cost / builtCost : 1.0f; }
+    [[nodiscard]] uint32_t GetNodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+    [[nodiscard]] uint32_t GetPendingCount() const { return static_cast<uint32_t>(pending.size()); }
+
+    bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const;
+
+
+    /**
+     * \brief Finds the objects that may intersect a frustum, rejecting whole subtrees outside of it.
+     * \details
+     * The planes a node is entirely inside of are not tested again for its children, and the objects of a node entirely
+     * inside the frustum are reported without any test. The objects of a leaf crossing the frustum are reported without
+     * testing their own box, leaving the exact test to the caller, which can batch them (see CullingBounds::CullSlots()).
+     * \tparam Function Type of the function. Must be callable as function(uint32_t id, bool contained).
+     * \param frustum The frustum planes.
+     * \param function The function receiving the objects, contained being true when the object is known to be entirely inside the frustum.
+     */
+    template<typename Function>
+    void QueryFrustum(const FrustumPlanes& frustum, Function&& function) const {
+      constexpr uint32_t allPlanes = (1u << FrustumPlanes::Count) - 1u;
+      if (!nodes.empty()) {
+        std::pair<uint32_t, uint32_t> stack[MaxDepth + 1u];
+        uint32_t size = 0u;
+        stack[size++] = { 0u, allPlanes };
+        while (size != 0u) {
+          auto [index, planes] = stack[--size];
+          const Node& node = nodes[index];
+          if (!Classify(frustum, node.Min, node.Max, planes)) {
+            continue;
+          }
+          if (planes == 0u) {
+            ForEachItem(index, [&function](uint32_t id) { function(id, true); });
+            continue;
+          }
+          if (node.Count != 0u) {
+            for (uint32_t item = node.First; item < node.First + node.Count; ++item) {
+              if (proxies[items[item]].State == ProxyState::Tree) {
+                function(items[item], false);
+              }
+            }
+            continue;
+          }
+          stack[size++] = { node.First + 1u, planes };
+          stack[size++] = { node.First, planes };
+        }
+      }
+
+      for (const uint32_t id : pending) {
+        uint32_t planes = allPlanes;
+        if (Classify(frustum, proxies[id].Min, proxies[id].Max, planes)) {
+          function(id, planes == 0u);
+        }
+      }
+    }
+
+
+    /**
+     * \brief Finds the objects whose box intersects a sphere.
+     * \tparam Function Type of the function. Must be callable as function(uint32_t id).
+     * \param sphere The sphere.
+     * \param function The function receiving the objects.
+     */
+    template<typename Function>
+    void QuerySphere(const BoundingSphere& sphere, Function&& function) const {
+      const float squaredRadius = sphere.Radius * sphere.Radius;
+      Query([&](const glm::vec3& min, const glm::vec3& max) {
+        const glm::vec3 offset = glm::max(min - sphere.Center, glm::vec3(0.0f)) + glm::max(sphere.Center - max, glm::vec3(0.0f));
+        return glm::dot(offset, offset) <= squaredRadius;
+      }, function);
+    }
+
+
+    /**
+     * \brief Finds the objects whose box intersects a box.
+     * \tparam Function Type of the function. Must be callable as function(uint32_t id).
+     * \param box The box.
+     * \param function The function receiving the objects.
+     */
+    template<typename Function>
+    void QueryBox(const BoundingBox& box, Function&& function) const {
+      const glm::vec3 boxMin = box.Min();
+      const glm::vec3 boxMax = box.Max();
+      Query([&](const glm::vec3& min, const glm::vec3& max) {
+        return min.x <= boxMax.x && max.x >= boxMin.x && min.y <= boxMax.y && max.y >= boxMin.y && min.z <= boxMax.z && max.z >= boxMin.z;
+      }, function);
+    }
+
+  private:
+    struct Node {
+      glm::vec3 Min = glm::vec3(FLT_MAX);
+      /**
+       * \brief Index of the left child for the inner nodes, the right child following it. Position of the first object in the items for the leaves.
+       */
+      uint32_t First = 0u;
+      glm::vec3 Max = glm::vec3(-FLT_MAX);
+      /**
+       * \brief Number of objects of a leaf, 0 for the inner nodes.
+       */
+      uint32_t Count = 0u;
+    };
+
+    enum class ProxyState : uint8_t {
+      Absent,
+      /**
+       * \brief Added since the last build, in the pending list.
+       */
+      Pending,
+      Tree
+    };
+
+    struct Proxy {
+      glm::vec3 Min = glm::vec3(0.0f);
+      glm::vec3 Max = glm::vec3(0.0f);
+      uint32_t PendingIndex = 0u;
+      ProxyState State = ProxyState::Absent;
+    };
+
+    struct BuildTask {
+      uint32_t Node = 0u;
+      uint32_t Begin = 0u;
+      uint32_t End = 0u;
+      uint32_t Depth = 0u;
+    };
+
+    /**
+     * \brief Tests a box against the planes of a frustum selected by a mask, clearing the planes the box is entirely inside of.
+     * \return False if the box is entirely outside a plane.
+     */
+    static bool Classify(const FrustumPlanes& frustum, const glm::vec3& min, const glm::vec3& max, uint32_t& planes) {
+      const glm::vec3 center = (min + max) * 0.5f;
+      const glm::vec3 extents = (max - min) * 0.5f;
+      for (uint32_t plane = 0u; plane < FrustumPlanes::Count; ++plane) {
+        if ((planes & (1u << plane)) == 0u) {
+          continue;
+        }
+        const glm::vec4& values = frustum.Planes[plane];
+        const float distance = glm::dot(glm::vec3(values), center) + values.w;
+        const float radius = glm::dot(glm::abs(glm::vec3(values)), extents);
+        if (distance + radius < 0.0f) {
+          return false;
+        }
+        if (distance - radius >= 0.0f) {
+          planes &= ~(1u << plane);
+        }
+      }
+      return true;
+    }
+
+
+    /**
+     * \brief Calls a function for every object of the subtree of a node.
+     */
+    template<typename Function>
+    void ForEachItem(uint32_t root, Function&& function) const {
+      uint32_t stack[MaxDepth + 1u];
+      uint32_t size = 0u;
+      stack[size++] = root;
+      while (size != 0u) {
+        const Node& node = nodes[stack[--size]];
+        if (node.Count == 0u) {
+          stack[size++] = node.First + 1u;
+          stack[size++] = node.First;
+          continue;
+        }
+        for (uint32_t item = node.First; item < node.First + node.Count; ++item) {
+          if (proxies[items[item]].State == ProxyState::Tree) {
+            function(items[item]);
+          }
+        }
+      }
+    }
+
+
+    /**
+     * \brief Calls a function for every object whose box passes a test, the nodes failing it being skipped with their subtree.
+     */
+    template<typename Test, typename Function>
+    void Query(Test&& test, Function&& function) const {
+      if (!nodes.empty()) {
+        uint32_t stack[MaxDepth + 1u];
+        uint32_t size = 0u;
+        stack[size++] = 0u;
+        while (size != 0u) {
+          const Node& node = nodes[stack[--size]];
+          if (!test(node.Min, node.Max)) {
+            continue;
+          }
+          if (node.Count == 0u) {
+            stack[size++] = node.First + 1u;
+            stack[size++] = node.First;
+            continue;
+          }
+          for (uint32_t item = node.First; item < node.First + node.Count; ++item) {
+            const Proxy& proxy = proxies[items[item]];
+            if (proxy.State == ProxyState::Tree && test(proxy.Min, proxy.Max)) {
+              function(items[item]);
+            }
+          }
+        }
+      }
+
+      for (const uint32_t id : pending) {
+        if (test(proxies[id].Min, proxies[id].Max)) {
+          function(id);
+        }
+      }
+    }
+
+    bool Step(TimeSlice* slice);
+    void Split(const BuildTask& task);
+    void Finish();
+    void RemovePending(uint32_t id);
+    static float Area(const glm::vec3& min, const glm::vec3& max);
+
+  private:
+    std::vector<Node> nodes;
+    std::vector<uint32_t> items;
+    std::vector<Proxy> proxies;
+    std::vector<uint32_t> pending;
+    // Objects of the tree removed or added again since the last build, still in the items but skipped.
+    uint32_t staleItems = 0u;
+    bool dirty = false;
+    // Surface area heuristic cost of the tree after the last refit and after the last build.
+    float cost = 0.0f;
+    float builtCost = 0.0f;
+
+    // Tree being built, replacing the current one once every task is done.
+    bool building = false;
+    std::vector<Node> buildNodes;
+    std::vector<uint32_t> buildItems;
+    std::vector<BuildTask> buildTasks;
+    uint32_t builtItems = 0u;
+  };
+}
@@ -0,0 +1,202 @@
+/**
+ * @file Culling.cpp
+ * @brief Implementation of the CullingBounds class.
+ */
+
+#include "Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef HEIMSKR_ENGINE_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace HeimskrEngine {
+#ifdef HEIMSKR_ENGINE_CULLING_SSE
+  namespace {
+    /**
+     * \brief Planes of a frustum with every coefficient broadcast to the 4 lanes of a register.
+     */
+    struct FrustumLanes {
+      explicit FrustumLanes(const FrustumPlanes& frustum) {
+        for (uint32_t plane = 0u; plane < FrustumPlanes::Count; ++plane) {
+          const glm::vec4& values = frustum.Planes[plane];
+          NormalX[plane] = _mm_set1_ps(values.x);
+          NormalY[plane] = _mm_set1_ps(values.y);
+          NormalZ[plane] = _mm_set1_ps(values.z);
+          Offset[plane] = _mm_set1_ps(values.w);
+          AbsoluteX[plane] = _mm_set1_ps(std::fabs(values.x));
+          AbsoluteY[plane] = _mm_set1_ps(std::fabs(values.y));
+          AbsoluteZ[plane] = _mm_set1_ps(std::fabs(values.z));
+        }
+      }
+
+      /**
+       * \brief Tests 4 instances against every plane.
+       * \return The mask of the visible instances, bit i for lane i.
+       */
+      [[nodiscard]] int Test(__m128 x, __m128 y, __m128 z, __m128 ex, __m128 ey, __m128 ez, __m128 r) const {
+        const __m128 zero = _mm_setzero_ps();
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (uint32_t plane = 0u; plane < FrustumPlanes::Count; ++plane) {
+          const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(NormalX[plane], x), _mm_mul_ps(NormalY[plane], y)), _mm_add_ps(_mm_mul_ps(NormalZ[plane], z), Offset[plane]));
+          const __m128 projected = _mm_add_ps(_mm_add_ps(_mm_mul_ps(AbsoluteX[plane], ex), _mm_mul_ps(AbsoluteY[plane], ey)), _mm_mul_ps(AbsoluteZ[plane], ez));
+          inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, _mm_min_ps(projected, r)), zero));
+        }
+        return _mm_movemask_ps(inside);
+      }
+
+      __m128 NormalX[FrustumPlanes::Count], NormalY[FrustumPlanes::Count], NormalZ[FrustumPlanes::Count], Offset[FrustumPlanes::Count];
+      __m128 AbsoluteX[FrustumPlanes::Count], AbsoluteY[FrustumPlanes::Count], AbsoluteZ[FrustumPlanes::Count];
+    };
+  }
+#endif
+
+
+  /**
+   * \brief Resizes the bounds to a number of slots, the new slots being cleared.
+   * \param count The number of instance slots.
+   */
+  void CullingBounds::Resize(uint32_t count) {
+    const uint32_t padded = (count + Lanes - 1u) / Lanes * Lanes;
+    if (padded > centerX.size()) {
+      for (auto* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) {
+        component->resize(padded, 0.0f);
+      }
+      radius.resize(padded, -FLT_MAX);
+    }
+    this->count = count;
+  }
+
+
+  /**
+   * \brief Sets the world-space bounds of a slot.
+   * \param slot The instance slot.
+   * \param box The bounding box in world space.
+   * \param sphere The bounding sphere in world space.
+   */
+  void CullingBounds::Set(uint32_t slot, const BoundingBox& box, const BoundingSphere& sphere) {
+    centerX[slot] = box.Center.x;
+    centerY[slot] = box.Center.y;
+    centerZ[slot] = box.Center.z;
+    extentX[slot] = box.Extents.x;
+    extentY[slot] = box.Extents.y;
+    extentZ[slot] = box.Extents.z;
+    // The sphere is only used through its radius, the box center being close enough to its center for the test.
+    radius[slot] = sphere.Radius + glm::length(sphere.Center - box.Center);
+  }
+
+
+  /**
+   * \brief Makes a slot always visible, for the meshes whose bounds are unknown.
+   * \param slot The instance slot.
+   */
+  void CullingBounds::SetUnbounded(uint32_t slot) {
+    centerX[slot] = centerY[slot] = centerZ[slot] = 0.0f;
+    extentX[slot] = extentY[slot] = extentZ[slot] = UnboundedExtent;
+    radius[slot] = UnboundedExtent;
+  }
+
+
+  /**
+   * \brief Clears a slot, so it is always culled.
+   * \param slot The instance slot.
+   */
+  void CullingBounds::Clear(uint32_t slot) {
+    centerX[slot] = centerY[slot] = centerZ[slot] = 0.0f;
+    extentX[slot] = extentY[slot] = extentZ[slot] = 0.0f;
+    radius[slot] = -FLT_MAX;
+  }
+
+
+  /**
+   * \brief Tests a range of slots against a frustum.
+   * \param frustum The planes of the view.
+   * \param begin The first tested slot, a multiple of Lanes.
+   * \param end The slot after the last tested one, at most Size().
+   * \param visibility Receives 1 for every visible slot of the range and 0 for the culled ones, indexed from slot 0.
+   * \return The number of visible slots in the range.
+   */
+  uint32_t CullingBounds::Cull(const FrustumPlanes& frustum, uint32_t begin, uint32_t end, uint8_t* visibility) const {
+    uint32_t visible = 0u;
+#ifdef HEIMSKR_ENGINE_CULLING_SSE
+    const FrustumLanes lanes(frustum);
+    for (uint32_t slot = begin; slot < end; slot += Lanes) {
+      const int mask = lanes.Test(_mm_loadu_ps(&centerX[slot]), _mm_loadu_ps(&centerY[slot]), _mm_loadu_ps(&centerZ[slot]),
+                                  _mm_loadu_ps(&extentX[slot]), _mm_loadu_ps(&extentY[slot]), _mm_loadu_ps(&extentZ[slot]), _mm_loadu_ps(&radius[slot]));
+      const uint32_t count = std::min(Lanes, end - slot);
+      for (uint32_t lane = 0u; lane < count; ++lane) {
+        const auto bit = static_cast<uint8_t>((mask >> lane) & 1);
+        visibility[slot + lane] = bit;
+        visible += bit;
+      }
+    }
+#else
+    for (uint32_t slot = begin; slot < end; ++slot) {
+      visibility[slot] = IsVisible(frustum, slot) ? 1u : 0u;
+      visible += visibility[slot];
+    }
+#endif
+    return visible;
+  }
+
+
+  /**
+   * \brief Tests a list of scattered slots against a frustum, e.g. the slots of the BVH leaves crossing its planes.
+   * \param frustum The planes of the view.
+   * \param slots The tested slots.
+   * \param count The number of tested slots.
+   * \param visible Receives the visible slots of the list, in their order. Must hold count slots, and can be the list itself, compacted in place.
+   * \return The number of visible slots in the list.
+   */
+  uint32_t CullingBounds::CullSlots(const FrustumPlanes& frustum, const uint32_t* slots, uint32_t count, uint32_t* visible) const {
+    uint32_t visibleCount = 0u;
+#ifdef HEIMSKR_ENGINE_CULLING_SSE
+    const FrustumLanes lanes(frustum);
+    for (uint32_t index = 0u; index < count; index += Lanes) {
+      // The missing lanes of the last iteration repeat the first slot, their result being ignored.
+      uint32_t gathered[Lanes];
+      const uint32_t used = std::min(Lanes, count - index);
+      for (uint32_t lane = 0u; lane < Lanes; ++lane) {
+        gathered[lane] = slots[index + (lane < used ? lane : 0u)];
+      }
+      auto gather = [&gathered](const std::vector<float>& component) {
+        return _mm_setr_ps(component[gathered[0]], component[gathered[1]], component[gathered[2]], component[gathered[3]]);
+      };
+      const int mask = lanes.Test(gather(centerX), gather(centerY), gather(centerZ), gather(extentX), gather(extentY), gather(extentZ), gather(radius));
+      // The lanes are gathered before, so the output can overwrite them.
+      for (uint32_t lane = 0u; lane < used; ++lane) {
+        visible[visibleCount] = gathered[lane];
+        visibleCount += static_cast<uint32_t>((mask >> lane) & 1);
+      }
+    }
+#else
+    for (uint32_t index = 0u; index < count; ++index) {
+      const uint32_t slot = slots[index];
+      if (IsVisible(frustum, slot)) {
+        visible[visibleCount++] = slot;
+      }
+    }
+#endif
+    return visibleCount;
+  }
+
+
+  /**
+   * \brief Tests a single slot against a frustum, as the SSE kernel does for 4 slots.
+   * \param frustum The planes of the view.
+   * \param slot The tested slot.
+   * \return True if the slot is visible.
+   */
+  bool CullingBounds::IsVisible(const FrustumPlanes& frustum, uint32_t slot) const {
+    for (const glm::vec4& plane : frustum.Planes) {
+      const float distance = plane.x * centerX[slot] + plane.y * centerY[slot] + plane.z * centerZ[slot] + plane.w;
+      const float projected = std::fabs(plane.x) * extentX[slot] + std::fabs(plane.y) * extentY[slot] + std::fabs(plane.z) * extentZ[slot];
+      if (distance + std::min(projected, radius[slot]) < 0.0f) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
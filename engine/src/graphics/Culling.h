@@ -0,0 +1,59 @@
+/**
+ * @file Culling.h
+ * @brief World-space bounds of the rendered instances, laid out for testing them against a frustum 4 at a time.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "utilities/Bounds.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define HEIMSKR_ENGINE_CULLING_SSE 1
+#endif
+
+namespace HeimskrEngine {
+  /**
+   * @class CullingBounds
+   * @brief Bounding box and sphere of every instance slot, stored as structure of arrays.
+   * @details
+   * Every component is stored in its own array, padded to a multiple of 4 slots, so the frustum test loads the same
+   * component of 4 consecutive slots in a single SSE register and tests 4 instances per iteration without any
+   * shuffle. An instance is culled when it is outside a plane, its distance to the plane being tested against the
+   * smaller of the projected box and the sphere radius, the tighter of the two conservative bounds. Cleared slots
+   * (free or without a mesh) are always culled, unbounded slots (see MeshBounds::IsBounded()) never are.
+   */
+  class CullingBounds {
+  public:
+    /**
+     * \brief Number of slots tested together, the start of every tested range must be a multiple of it.
+     */
+    static constexpr uint32_t Lanes = 4u;
+
+    /**
+     * \brief Half size of the unbounded slots, large enough to cross every plane while keeping the test away from infinities.
+     */
+    static constexpr float UnboundedExtent = FLT_MAX / 8.0f;
+
+    void Resize(uint32_t count);
+    void Set(uint32_t slot, const BoundingBox& box, const BoundingSphere& sphere);
+    void SetUnbounded(uint32_t slot);
+    void Clear(uint32_t slot);
+    uint32_t Cull(const FrustumPlanes& frustum, uint32_t begin, uint32_t end, uint8_t* visibility) const;
+    uint32_t CullSlots(const FrustumPlanes& frustum, const uint32_t* slots, uint32_t count, uint32_t* visible) const;
+    [[nodiscard]] bool IsVisible(const FrustumPlanes& frustum, uint32_t slot) const;
+
+    [[nodiscard]] uint32_t Size() const { return count; }
+
+  private:
+    uint32_t count = 0u;
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+    std::vector<float> radius;
+  };
+}
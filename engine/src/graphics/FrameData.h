@@ -0,0 +1,126 @@
+/**
+ * @file FrameData.h
+ * @brief Immutable snapshot of everything the renderer needs to draw a frame.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "../ecs/ECS.h"
+#include "RenderCommands.h"
+#include "buffers/Instance.h"
+
+namespace HeimskrEngine {
+  class AppInterface;
+
+  /**
+   * \brief Contiguous range of instance slots to upload, with its data stored in FrameData::Instances.
+   */
+  struct InstanceRange {
+    uint32_t First = 0u;
+    uint32_t Count = 0u;
+    uint32_t Offset = 0u;
+  };
+
+
+  /**
+   * \brief Render data produced by the simulation for one frame.
+   * \details
+   * The simulation fills it from the registry, then the renderer consumes it on the thread owning the GL context. Once
+   * published, it is never modified until the renderer releases it, so the simulation can build the next frame at the
+   * same time. The vectors are cleared but keep their capacity between frames to avoid reallocations.
+   */
+  struct FrameData {
+    /**
+     * \brief Clears the frame so it can be filled again, keeping the allocated memory.
+     * \param frame The number of the new frame.
+     */
+    void Reset(uint64_t frame) {
+      Frame = frame;
+      SimulationStart = std::chrono::steady_clock::now();
+      HasCamera = false;
+      VisibleInstances = 0u;
+      CulledInstances = 0u;
+      Width = 0;
+      Height = 0;
+      InstanceCapacity = 0u;
+      Ranges.clear();
+      Instances.clear();
+      Commands.clear();
+      Batches.clear();
+      BatchInstances.clear();
+      TransientInstances.clear();
+      Meshes.clear();
+      ReleasedMeshes.clear();
+      Layers.clear();
+      DetachedLayers.clear();
+    }
+
+    uint64_t Frame = 0u;
+    /**
+     * \brief Time at which the simulation started building the frame, used to measure the input-to-display latency.
+     */
+    std::chrono::steady_clock::time_point SimulationStart;
+    /**
+     * \brief Simulation time of the frame and time since the previous frame, in seconds, for the FrameBlock uniforms.
+     */
+    double Time = 0.0;
+    float DeltaTime = 0.0f;
+
+    bool HasCamera = false;
+    Camera3D Camera;
+    Transform3D CameraTransform;
+    /**
+     * \brief Mesh entities inside and outside the frustum of the camera, reported with the render statistics.
+     */
+    uint32_t VisibleInstances = 0u;
+    uint32_t CulledInstances = 0u;
+
+    /**
+     * \brief New size of the frame buffer, or 0 if it did not change.
+     */
+    int32_t Width = 0;
+    int32_t Height = 0;
+
+    /**
+     * \brief Capacity the instance buffer must have, or 0 if it did not change.
+     */
+    uint32_t InstanceCapacity = 0u;
+    std::vector<InstanceRange> Ranges;
+    std::vector<InstanceData> Instances;
+    /**
+     * \brief Draw commands merged from the per-thread buckets, sorted by key.
+     */
+    std::vector<RenderCommand> Commands;
+    /**
+     * \brief Instanced draws built from the sorted commands, executed by the renderer.
+     */
+    std::vector<RenderBatch> Batches;
+    /**
+     * \brief Index of every instance of the batches in its instance buffer, uploaded every frame.
+     */
+    std::vector<uint32_t> BatchInstances;
+    /**
+     * \brief Instance data of the transient commands, uploaded every frame.
+     */
+    std::vector<InstanceData> TransientInstances;
+    /**
+     * \brief Meshes referenced by the commands, kept alive until the frame is rendered.
+     */
+    std::vector<Mesh3D> Meshes;
+    /**
+     * \brief Meshes of the entities destroyed or given another mesh since the last frame, culled or not, dropped by the renderer with the GL context current.
+     */
+    std::vector<Mesh3D> ReleasedMeshes;
+    /**
+     * \brief Layers attached when the frame was simulated, whose OnRender() is called by the renderer.
+     */
+    std::vector<AppInterface*> Layers;
+    /**
+     * \brief Layers detached since the previous frame, deleted by the renderer once this frame is drawn since no frame left in the pipeline references them.
+     */
+    std::vector<AppInterface*> DetachedLayers;
+  };
+}
@@ -0,0 +1,269 @@
+/**
+ * @file RenderCommands.cpp
+ * @brief Implementation of the RenderCommandBucket and RenderCommandQueue classes.
+ */
+
+#include "RenderCommands.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+#include "../core/JobSystem.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Records a draw of a mesh entity whose instance data lives in the persistent instance buffer.
+   * \param mesh The mesh to draw.
+   * \param slot The slot of the entity in the instance buffer (see RenderInstanceComponent).
+   * \param material The material of the draw, used for sorting.
+   * \param pass The pass of the draw.
+   * \param depth The quantized view depth of the draw (see RenderCommandQueue::GetDepth()).
+   */
+  void RenderCommandBucket::Submit(const Mesh3D& mesh, uint32_t slot, uint32_t material, RenderPass pass, uint32_t depth) {
+    Retain(mesh);
+    commands.push_back({ RenderCommand::MakeKey(pass, 0u, 0u, material, mesh->GetID(), depth), mesh.get(), slot, 0u });
+  }
+
+
+  /**
+   * \brief Records a draw with its own model matrix, uploaded for this frame only.
+   * \param mesh The mesh to draw.
+   * \param model The model matrix of the draw.
+   * \param material The material of the draw.
+   * \param pass The pass of the draw.
+   * \details The depth is set when the commands are merged, since the camera of the frame might not be known yet.
+   */
+  void RenderCommandBucket::Submit(const Mesh3D& mesh, const glm::mat4& model, uint32_t material, RenderPass pass) {
+    Retain(mesh);
+    const auto instance = static_cast<uint32_t>(instances.size());
+    instances.push_back({ model, material });
+    commands.push_back({ RenderCommand::MakeKey(pass, RenderCommand::Transient, 0u, material, mesh->GetID(), 0u), mesh.get(), instance, RenderCommand::Transient });
+  }
+
+
+  /**
+   * \brief Clears the recorded commands, keeping the allocated memory.
+   */
+  void RenderCommandBucket::Clear() {
+    commands.clear();
+    instances.clear();
+    meshes.clear();
+  }
+
+
+  /**
+   * \brief Keeps a reference to a mesh until the frame is rendered, so the commands can point to it without owning it.
+   * \param mesh The recorded mesh.
+   */
+  void RenderCommandBucket::Retain(const Mesh3D& mesh) {
+    if (meshes.empty() || meshes.back() != mesh) {
+      meshes.push_back(mesh);
+    }
+  }
+
+
+  /**
+   * \brief Constructor for the RenderCommandQueue class.
+   * \param threadCount The number of workers of the job system recording the commands.
+   */
+  RenderCommandQueue::RenderCommandQueue(uint32_t threadCount) : buckets(std::make_unique<RenderCommandBucket[]>(threadCount)), bucketCount(threadCount) {}
+
+
+  /**
+   * \brief Gets the bucket of the calling worker, to record many commands without going through the queue.
+   * \details Must only be called from a worker of the job system, other threads must use Submit().
+   * \return The bucket of the calling thread.
+   */
+  RenderCommandBucket& RenderCommandQueue::GetBucket() {
+    const uint32_t index = JobSystem::GetThreadIndex();
+    if (index >= bucketCount) {
+      HEIMSKR_ERROR(fmt::format("Render commands recorded without lock from thread {}, which is not a worker.", index));
+      return foreignBucket;
+    }
+    return buckets[index];
+  }
+
+
+  /**
+   * \brief Sets the camera of the frame being recorded, used to compute the depth of the draws.
+   * \details Must be called before the mesh entities are recorded and the commands merged, the recording threads only read it.
+   * \param camera The camera of the frame.
+   * \param transform The transform of the camera.
+   */
+  void RenderCommandQueue::SetCamera(const Camera3D& camera, const Transform3D& transform) {
+    view = Camera3D::View(transform);
+    nearPlane = camera.NearPlane;
+    farPlane = camera.FarPlane;
+    hasCamera = true;
+  }
+
+
+  /**
+   * \brief Quantizes the distance of a point to the camera of the frame for the sort keys.
+   * \param position The position in world space, usually the origin of the model matrix.
+   * \return The depth between 0 at the near plane and RenderCommand::MaxDepth at the far plane, or 0 without camera.
+   */
+  uint32_t RenderCommandQueue::GetDepth(const glm::vec3& position) const {
+    if (!hasCamera) {
+      return 0u;
+    }
+    // The camera looks down -Z in view space.
+    const float distance = -(view * glm::vec4(position, 1.0f)).z;
+    const float normalized = std::clamp((distance - nearPlane) / (farPlane - nearPlane), 0.0f, 1.0f);
+    return static_cast<uint32_t>(normalized * static_cast<float>(RenderCommand::MaxDepth));
+  }
+
+
+  /**
+   * \brief Records a draw of a mesh entity from any thread.
+   * \param mesh The mesh to draw.
+   * \param slot The slot of the entity in the instance buffer.
+   * \param material The material of the draw.
+   * \param pass The pass of the draw.
+   * \param depth The quantized view depth of the draw (see GetDepth()).
+   */
+  void RenderCommandQueue::Submit(const Mesh3D& mesh, uint32_t slot, uint32_t material, RenderPass pass, uint32_t depth) {
+    const uint32_t index = JobSystem::GetThreadIndex();
+    if (index < bucketCount) {
+      buckets[index].Submit(mesh, slot, material, pass, depth);
+      return;
+    }
+    std::lock_guard lock(foreignMutex);
+    foreignBucket.Submit(mesh, slot, material, pass, depth);
+  }
+
+
+  /**
+   * \brief Records a draw with its own model matrix from any thread.
+   * \param mesh The mesh to draw.
+   * \param model The model matrix of the draw.
+   * \param material The material of the draw.
+   * \param pass The pass of the draw.
+   */
+  void RenderCommandQueue::Submit(const Mesh3D& mesh, const glm::mat4& model, uint32_t material, RenderPass pass) {
+    const uint32_t index = JobSystem::GetThreadIndex();
+    if (index < bucketCount) {
+      buckets[index].Submit(mesh, model, material, pass);
+      return;
+    }
+    std::lock_guard lock(foreignMutex);
+    foreignBucket.Submit(mesh, model, material, pass);
+  }
+
+
+  /**
+   * \brief Moves the commands of every bucket into the frame data, sorted by key, and clears the buckets.
+   * \details Must be called once the recording is done. The transient instances are concatenated and the commands renumbered accordingly, and their depth is computed from their model matrix.
+   * \param commands The command list of the frame.
+   * \param instances The transient instances of the frame.
+   * \param meshes The meshes referenced by the commands, released once the frame is rendered.
+   */
+  void RenderCommandQueue::Merge(std::vector<RenderCommand>& commands, std::vector<InstanceData>& instances, std::vector<Mesh3D>& meshes) {
+    auto append = [&](RenderCommandBucket& bucket) {
+      const auto offset = static_cast<uint32_t>(instances.size());
+      for (RenderCommand command : bucket.commands) {
+        if ((command.Flags & RenderCommand::Transient) != 0u) {
+          command.SetDepth(GetDepth(glm::vec3(bucket.instances[command.Instance].Model[3])));
+          command.Instance += offset;
+        }
+        commands.push_back(command);
+      }
+      instances.insert(instances.end(), bucket.instances.begin(), bucket.instances.end());
+      std::move(bucket.meshes.begin(), bucket.meshes.end(), std::back_inserter(meshes));
+      bucket.Clear();
+    };
+
+    size_t total = commands.size();
+    for (uint32_t index = 0u; index < bucketCount; ++index) {
+      total += buckets[index].commands.size();
+    }
+    commands.reserve(total + foreignBucket.commands.size());
+
+    for (uint32_t index = 0u; index < bucketCount; ++index) {
+      append(buckets[index]);
+    }
+    {
+      std::lock_guard lock(foreignMutex);
+      append(foreignBucket);
+    }
+
+    RadixSort(commands);
+    hasCamera = false;
+  }
+
+
+  /**
+   * \brief Sorts the commands by key with a stable least significant digit radix sort, one byte per pass.
+   * \details The histograms of the 8 bytes are built in a single read of the keys, and the passes whose byte is the same for every command are skipped, which is most of them since the keys of a frame share their high bits. Linear in the number of commands, unlike a comparison sort.
+   * \param commands The commands to sort.
+   */
+  void RenderCommandQueue::RadixSort(std::vector<RenderCommand>& commands) {
+    constexpr uint32_t passes = sizeof(uint64_t);
+    const size_t count = commands.size();
+    if (count < 2u) {
+      return;
+    }
+
+    std::array<std::array<uint32_t, 256>, passes> histograms {};
+    for (const RenderCommand& command : commands) {
+      for (uint32_t pass = 0u; pass < passes; ++pass) {
+        histograms[pass][(command.SortKey >> (pass * 8u)) & 0xFFu]++;
+      }
+    }
+
+    sorted.resize(count);
+    RenderCommand* source = commands.data();
+    RenderCommand* destination = sorted.data();
+    for (uint32_t pass = 0u; pass < passes; ++pass) {
+      auto& histogram = histograms[pass];
+      const uint32_t shift = pass * 8u;
+      if (histogram[(source[0].SortKey >> shift) & 0xFFu] == count) {
+        continue;
+      }
+
+      // Turning the counts into the first position of every byte value.
+      uint32_t offset = 0u;
+      for (uint32_t& bucket : histogram) {
+        const uint32_t size = bucket;
+        bucket = offset;
+        offset += size;
+      }
+      for (size_t index = 0u; index < count; ++index) {
+        destination[histogram[(source[index].SortKey >> shift) & 0xFFu]++] = source[index];
+      }
+      std::swap(source, destination);
+    }
+
+    if (source != commands.data()) {
+      commands.swap(sorted);
+    }
+  }
+
+
+  /**
+   * \brief Groups the consecutive sorted commands drawing the same mesh with the same state into instanced batches.
+   * \details The sort keeps the commands of a mesh together within a state group, so thousands of entities sharing a mesh become a single draw call. Transparent commands are only batched while consecutive, so they stay back to front.
+   * \param commands The commands sorted by Merge().
+   * \param batches The batches of the frame.
+   * \param indices The instance index of every command, in batch order, uploaded to the batch buffer.
+   */
+  void RenderCommandQueue::Batch(const std::vector<RenderCommand>& commands, std::vector<RenderBatch>& batches, std::vector<uint32_t>& indices) {
+    indices.reserve(indices.size() + commands.size());
+    RenderBatch* batch = nullptr;
+    for (const RenderCommand& command : commands) {
+      const RenderPass pass = command.GetPass();
+      const uint32_t shader = command.GetShader();
+      if (batch == nullptr || batch->Mesh != command.Mesh || batch->Flags != command.Flags || batch->Pass != pass || batch->Shader != shader) {
+        batch = &batches.emplace_back();
+        batch->Mesh = command.Mesh;
+        batch->First = static_cast<uint32_t>(indices.size());
+        batch->Flags = command.Flags;
+        batch->Pass = pass;
+        batch->Shader = shader;
+      }
+      indices.push_back(command.Instance);
+      batch->Count++;
+    }
+  }
+}
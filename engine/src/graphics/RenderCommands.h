@@ -0,0 +1,224 @@
+/**
+ * @file RenderCommands.h
+ * @brief Draw commands recorded as plain data from any thread, then merged and executed on the GL thread.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../ecs/ECS.h"
+#include "buffers/Instance.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Pass of a draw, the passes being drawn in this order.
+   */
+  enum class RenderPass : uint32_t {
+    /**
+     * \brief Drawn front to back, so the depth test rejects the hidden fragments early.
+     */
+    Opaque = 0u,
+    /**
+     * \brief Drawn back to front after the opaque draws, with blending and without writing the depth.
+     */
+    Transparent = 1u
+  };
+
+
+  /**
+   * \brief Draw request, holding no GL state so it can be built on any thread.
+   */
+  struct RenderCommand {
+    /**
+     * \brief The command uses a transient instance of the frame instead of a persistent slot of the instance buffer.
+     */
+    static constexpr uint32_t Transient = 1u << 0u;
+
+    /**
+     * \brief Number of bits of the quantized depth in the sort key, see RenderCommandQueue::GetDepth().
+     */
+    static constexpr uint32_t DepthBits = 24u;
+    static constexpr uint32_t MaxDepth = (1u << DepthBits) - 1u;
+    static constexpr uint32_t ShaderBits = 6u;
+    static constexpr uint32_t MaterialBits = 15u;
+    static constexpr uint32_t MeshBits = 16u;
+
+    /**
+     * \brief Key the merged commands are sorted by, see MakeKey().
+     */
+    uint64_t SortKey = 0u;
+    /**
+     * \brief Mesh to draw, kept alive by the bucket that recorded the command until the frame is rendered.
+     */
+    const ShadedMesh* Mesh = nullptr;
+    /**
+     * \brief Slot in the instance buffer, or index in FrameData::TransientInstances for transient commands.
+     */
+    uint32_t Instance = 0u;
+    uint32_t Flags = 0u;
+
+    /**
+     * \brief Builds the 64-bit key sorting the commands in the order that changes the least GL state.
+     * \details
+     * The pass comes first. Opaque keys then hold the instance source, shader, material, mesh and depth, so the draws
+     * sharing their state are consecutive and sorted front to back within the group. Transparent keys hold the
+     * inverted depth right after the pass, since they must be drawn back to front whatever their state.
+     * \param pass The pass of the draw.
+     * \param flags The command flags.
+     * \param shader The shader program of the draw.
+     * \param material The material of the draw.
+     * \param mesh The identifier of the mesh (see Mesh::GetID()), only its low bits being used to group the draws.
+     * \param depth The quantized view depth of the draw, 0 being the nearest.
+     * \return The sort key.
+     */
+    static uint64_t MakeKey(RenderPass pass, uint32_t flags, uint32_t shader, uint32_t material, uint32_t mesh, uint32_t depth) {
+      const uint64_t state = (static_cast<uint64_t>(flags & Transient) << (ShaderBits + MaterialBits + MeshBits))
+                             | (static_cast<uint64_t>(shader & Mask(ShaderBits)) << (MaterialBits + MeshBits))
+                             | (static_cast<uint64_t>(material & Mask(MaterialBits)) << MeshBits)
+                             | (mesh & Mask(MeshBits));
+      const uint64_t passBits = static_cast<uint64_t>(pass) << 62u;
+      if (pass == RenderPass::Transparent) {
+        return passBits | (static_cast<uint64_t>(MaxDepth - std::min(depth, MaxDepth)) << (62u - DepthBits)) | state;
+      }
+      return passBits | (state << DepthBits) | std::min(depth, MaxDepth);
+    }
+
+    [[nodiscard]] RenderPass GetPass() const { return static_cast<RenderPass>(SortKey >> 62u); }
+
+
+    /**
+     * \brief Replaces the depth in the key, for the commands recorded before the camera of the frame was known.
+     * \param depth The quantized view depth of the draw, 0 being the nearest.
+     */
+    void SetDepth(uint32_t depth) {
+      depth = std::min(depth, MaxDepth);
+      if (GetPass() == RenderPass::Transparent) {
+        const uint32_t shift = 62u - DepthBits;
+        SortKey = (SortKey & ~(static_cast<uint64_t>(MaxDepth) << shift)) | (static_cast<uint64_t>(MaxDepth - depth) << shift);
+      } else {
+        SortKey = (SortKey & ~static_cast<uint64_t>(MaxDepth)) | depth;
+      }
+    }
+
+    /**
+     * \brief Gets the shader program of the command from its key.
+     * \return The shader index given to MakeKey().
+     */
+    [[nodiscard]] uint32_t GetShader() const {
+      const uint32_t shift = GetPass() == RenderPass::Transparent ? MaterialBits + MeshBits : MaterialBits + MeshBits + DepthBits;
+      return static_cast<uint32_t>(SortKey >> shift) & Mask(ShaderBits);
+    }
+
+  private:
+    static constexpr uint32_t Mask(uint32_t bits) { return (1u << bits) - 1u; }
+  };
+
+
+  /**
+   * \brief Run of sorted commands sharing their mesh and state, drawn with a single instanced call.
+   */
+  struct RenderBatch {
+    const ShadedMesh* Mesh = nullptr;
+    /**
+     * \brief Position of the instance index of the first command in FrameData::BatchInstances.
+     */
+    uint32_t First = 0u;
+    uint32_t Count = 0u;
+    uint32_t Flags = 0u;
+    RenderPass Pass = RenderPass::Opaque;
+    uint32_t Shader = 0u;
+  };
+
+
+  /**
+   * \brief GL state changes issued by the renderer for the last frame, see Renderer::Execute().
+   */
+  struct RenderStats {
+    /**
+     * \brief Draws, one per batch.
+     */
+    uint32_t Draws = 0u;
+    /**
+     * \brief GL draw calls, a single multi-draw per run of batches sharing their state when the driver supports it, one per batch otherwise.
+     */
+    uint32_t DrawCalls = 0u;
+    uint32_t Instances = 0u;
+    uint32_t PassChanges = 0u;
+    uint32_t ShaderChanges = 0u;
+    /**
+     * \brief Switches between the persistent and the transient instance buffers.
+     */
+    uint32_t InstanceBufferChanges = 0u;
+    /**
+     * \brief Mesh entities drawn and skipped by the frustum culling.
+     */
+    uint32_t Visible = 0u;
+    uint32_t Culled = 0u;
+  };
+
+
+  /**
+   * @class RenderCommandBucket
+   * @brief Command list owned by a single recording thread.
+   */
+  class alignas(64) RenderCommandBucket {
+  public:
+    void Submit(const Mesh3D& mesh, uint32_t slot, uint32_t material, RenderPass pass, uint32_t depth);
+    void Submit(const Mesh3D& mesh, const glm::mat4& model, uint32_t material, RenderPass pass);
+    void Clear();
+
+  private:
+    friend class RenderCommandQueue;
+
+    void Retain(const Mesh3D& mesh);
+
+  private:
+    std::vector<RenderCommand> commands;
+    std::vector<InstanceData> instances;
+    // Consecutive commands mostly share their mesh, so only the last retained one is compared.
+    std::vector<Mesh3D> meshes;
+  };
+
+
+  /**
+   * @class RenderCommandQueue
+   * @brief Per-thread command buckets filled in parallel during the simulation.
+   * @details
+   * Every worker of the job system records into its own bucket, indexed by JobSystem::GetThreadIndex(), so recording
+   * takes no lock and the buckets do not share cache lines. Threads outside the job system record into a shared bucket
+   * guarded by a mutex. Once the recording jobs are done, Merge() moves all the buckets into the frame data, sorted by
+   * key with a radix sort, where the renderer executes them on the thread owning the GL context.
+   */
+  class RenderCommandQueue {
+  public:
+    explicit RenderCommandQueue(uint32_t threadCount = 1u);
+
+    RenderCommandBucket& GetBucket();
+    void SetCamera(const Camera3D& camera, const Transform3D& transform);
+    [[nodiscard]] uint32_t GetDepth(const glm::vec3& position) const;
+    void Submit(const Mesh3D& mesh, uint32_t slot, uint32_t material, RenderPass pass, uint32_t depth);
+    void Submit(const Mesh3D& mesh, const glm::mat4& model, uint32_t material, RenderPass pass = RenderPass::Opaque);
+    void Merge(std::vector<RenderCommand>& commands, std::vector<InstanceData>& instances, std::vector<Mesh3D>& meshes);
+    static void Batch(const std::vector<RenderCommand>& commands, std::vector<RenderBatch>& batches, std::vector<uint32_t>& indices);
+
+  private:
+    void RadixSort(std::vector<RenderCommand>& commands);
+
+  private:
+    std::unique_ptr<RenderCommandBucket[]> buckets;
+    uint32_t bucketCount = 0u;
+    RenderCommandBucket foreignBucket;
+    std::mutex foreignMutex;
+    // View of the camera of the frame being recorded, to compute the depth of the draws.
+    glm::mat4 view = glm::mat4(1.0f);
+    float nearPlane = 0.0f;
+    float farPlane = 1.0f;
+    bool hasCamera = false;
+    // Second buffer of the radix sort, kept between frames.
+    std::vector<RenderCommand> sorted;
+  };
+}
@@ -0,0 +1,455 @@
+/**
+ * @file RenderExtractor.cpp
+ * @brief Implementation of the RenderExtractor class.
+ */
+
+#include "RenderExtractor.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "../core/JobSystem.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Destructor for the RenderExtractor class.
+   */
+  RenderExtractor::~RenderExtractor() {
+    Disconnect();
+    if (rebuildTask != nullptr) {
+      rebuildTask->Cancel();
+    }
+  }
+
+
+  /**
+   * \brief Connects the extractor to the registry signals.
+   * \param registry The scene registry to mirror.
+   */
+  void RenderExtractor::Connect(entt::registry& registry) {
+    Disconnect();
+    this->registry = &registry;
+
+    // Creating the storages up front so they are never created from inside a signal.
+    registry.storage<RenderInstanceComponent>();
+    registry.storage<DirtyTransformComponent>();
+
+    registry.on_construct<MeshComponent>().connect<&RenderExtractor::OnMeshConstruct>(this);
+    registry.on_update<MeshComponent>().connect<&RenderExtractor::OnChange>();
+    registry.on_destroy<MeshComponent>().connect<&RenderExtractor::OnMeshDestroy>(this);
+    registry.on_destroy<RenderInstanceComponent>().connect<&RenderExtractor::OnInstanceDestroy>(this);
+    registry.on_construct<TransformComponent>().connect<&RenderExtractor::OnChange>();
+    registry.on_update<TransformComponent>().connect<&RenderExtractor::OnChange>();
+    registry.on_destroy<TransformComponent>().connect<&RenderExtractor::OnTransformDestroy>(this);
+  }
+
+
+  /**
+   * \brief Disconnects the extractor from the registry signals.
+   */
+  void RenderExtractor::Disconnect() {
+    if (registry == nullptr) {
+      return;
+    }
+    registry->on_construct<MeshComponent>().disconnect(this);
+    registry->on_update<MeshComponent>().disconnect<&RenderExtractor::OnChange>();
+    registry->on_destroy<MeshComponent>().disconnect(this);
+    registry->on_destroy<RenderInstanceComponent>().disconnect(this);
+    registry->on_construct<TransformComponent>().disconnect<&RenderExtractor::OnChange>();
+    registry->on_update<TransformComponent>().disconnect<&RenderExtractor::OnChange>();
+    registry->on_destroy<TransformComponent>().disconnect(this);
+    registry = nullptr;
+  }
+
+
+  /**
+   * \brief Recomputes the instance data of every entity tagged as dirty since the last extraction.
+   * \param alpha The position of the frame between the last two fixed updates, used to blend the interpolated transforms.
+   */
+  void RenderExtractor::Extract(float alpha) {
+    if (registry == nullptr) {
+      return;
+    }
+
+    registry->view<DirtyTransformComponent, RenderInstanceComponent>().each([this](entt::entity entity, const RenderInstanceComponent& instance) {
+      InstanceData& data = instances[instance.Slot];
+      const auto* transform = registry->try_get<TransformComponent>(entity);
+      const auto& mesh = registry->get<MeshComponent>(entity);
+      data.Model = transform != nullptr ? transform->Transform.Matrix() : glm::mat4(1.0f);
+      data.Material = mesh.Material;
+      UpdateBounds(instance.Slot, mesh);
+      RetainMesh(instance.Slot, mesh.Mesh);
+      MarkDirty(instance.Slot);
+    });
+    registry->clear<DirtyTransformComponent>();
+
+    registry->view<InterpolatedTransformComponent, TransformComponent, RenderInstanceComponent>().each([this, alpha](entt::entity entity, InterpolatedTransformComponent& interpolated, const TransformComponent& transform, const RenderInstanceComponent& instance) {
+      const bool moving = !(interpolated.Previous == transform.Transform);
+      if (moving || interpolated.Moving) {
+        instances[instance.Slot].Model = Transform3D::Interpolate(interpolated.Previous, transform.Transform, alpha).Matrix();
+        UpdateBounds(instance.Slot, registry->get<MeshComponent>(entity));
+        MarkDirty(instance.Slot);
+      }
+      interpolated.Moving = moving;
+    });
+  }
+
+
+  /**
+   * \brief Copies the dirty slots into the frame data, for the renderer to upload them, with the meshes to release.
+   * \details Dirty slots are sorted and coalesced into ranges. Every slot is copied (and the buffer reallocated) only when the number of slots outgrows the capacity of the instance buffer.
+   * \param frame The frame data being built.
+   */
+  void RenderExtractor::Flush(FrameData& frame) {
+    const uint32_t count = static_cast<uint32_t>(instances.size());
+    stats = ExtractionStats();
+    stats.Instances = count - static_cast<uint32_t>(freeSlots.size());
+    stats.Visible = stats.Instances;
+    culling = false;
+    listed = false;
+
+    auto copy = [&](uint32_t first, uint32_t last) {
+      const uint32_t rangeCount = last - first + 1u;
+      frame.Ranges.push_back({ first, rangeCount, static_cast<uint32_t>(frame.Instances.size()) });
+      frame.Instances.insert(frame.Instances.end(), instances.begin() + first, instances.begin() + first + rangeCount);
+      stats.UploadedInstances += rangeCount;
+      stats.UploadedRanges++;
+      stats.UploadedBytes += rangeCount * sizeof(InstanceData);
+    };
+
+    if (count > capacity) {
+      capacity = std::max({ count, capacity * 2u, InitialCapacity });
+      frame.InstanceCapacity = capacity;
+      copy(0u, count - 1u);
+    } else if (!dirtySlots.empty()) {
+      std::sort(dirtySlots.begin(), dirtySlots.end());
+
+      uint32_t first = dirtySlots.front();
+      uint32_t last = first;
+      for (const uint32_t slot : dirtySlots) {
+        if (slot > last + RangeMergeGap + 1u) {
+          copy(first, last);
+          first = slot;
+        }
+        last = slot;
+      }
+      copy(first, last);
+    }
+
+    for (const uint32_t slot : dirtySlots) {
+      dirtyFlags[slot] = 0u;
+    }
+    dirtySlots.clear();
+
+    frame.ReleasedMeshes.insert(frame.ReleasedMeshes.end(), std::make_move_iterator(releasedMeshes.begin()), std::make_move_iterator(releasedMeshes.end()));
+    releasedMeshes.clear();
+  }
+
+
+  /**
+   * \brief Refits the hierarchy to the bounds extracted this frame, and schedules its rebuild when it degraded.
+   * \details Must be called after Extract(). The first tree is built at once, the next ones in the background so a rebuild never causes a frame spike.
+   * \param scheduler The scheduler running the rebuilds.
+   */
+  void RenderExtractor::UpdateHierarchy(TimeSlicedScheduler& scheduler) {
+    hierarchy.Refit();
+    if (!hierarchy.NeedsRebuild()) {
+      return;
+    }
+    if (!hierarchy.HasTree()) {
+      hierarchy.Build();
+      return;
+    }
+    // The hierarchy only reports the rebuild as started once its first slice ran, which the budget of the scheduler can delay by a few frames.
+    if (rebuildTask != nullptr && !rebuildTask->IsDone() && !rebuildTask->IsCancelled()) {
+      return;
+    }
+    rebuildTask = scheduler.Schedule("Scene hierarchy rebuild", [this](TimeSlice& slice) {
+      return hierarchy.Rebuild(slice);
+    });
+  }
+
+
+  /**
+   * \brief Tests the world bounds of every instance against the frustum of the frame, in parallel on the workers of the job system.
+   * \details Must be called after Flush(), the visibility being reset by the next flush. Without a call, every instance is recorded.
+   * \param frustum The frustum planes of the camera (see FrustumPlanes::FromMatrix()).
+   * \param jobs The job system running the tests.
+   */
+  void RenderExtractor::Cull(const FrustumPlanes& frustum, JobSystem& jobs) {
+    const uint32_t count = bounds.Size();
+    uint32_t visible = 0u;
+    if (count < HierarchyThreshold || !hierarchy.HasTree()) {
+      visibility.resize(count);
+      visible = jobs.ParallelReduce(count, CullGrain, 0u, [&](uint32_t begin, uint32_t end) {
+        return bounds.Cull(frustum, begin, end, visibility.data());
+      }, [](uint32_t left, uint32_t right) {
+        return left + right;
+      });
+      stats.Tested = count;
+    } else {
+      // The instances of the nodes inside the frustum are visible without testing them, those of the leaves crossing its planes are tested together.
+      // Only the visible slots are listed, so neither the culling nor the recording goes over the rejected subtrees.
+      visibleSlots.clear();
+      candidates.clear();
+      hierarchy.QueryFrustum(frustum, [this](uint32_t slot, bool contained) {
+        if (contained) {
+          visibleSlots.push_back(slot);
+        } else {
+          candidates.push_back(slot);
+        }
+      });
+      const uint32_t tested = static_cast<uint32_t>(candidates.size());
+      candidates.resize(bounds.CullSlots(frustum, candidates.data(), tested, candidates.data()));
+      visibleSlots.insert(visibleSlots.end(), candidates.begin(), candidates.end());
+      visibleSlots.insert(visibleSlots.end(), unboundedSlots.begin(), unboundedSlots.end());
+      visible = static_cast<uint32_t>(visibleSlots.size());
+      stats.Tested = tested;
+      listed = true;
+    }
+    // The free slots are cleared, hence always culled.
+    stats.Visible = visible;
+    stats.Culled = stats.Instances - visible;
+    culling = true;
+  }
+
+
+  /**
+   * \brief Records a draw command for every visible mesh entity, in parallel on the workers of the job system.
+   * \details The registry is only read, so it must not be modified until the call returns. After a culling through the hierarchy, only the visible slots are visited.
+   * \param queue The queue receiving the commands in the bucket of each worker.
+   * \param jobs The job system running the recording.
+   */
+  void RenderExtractor::Record(RenderCommandQueue& queue, JobSystem& jobs) const {
+    if (registry == nullptr) {
+      return;
+    }
+
+    const auto& meshes = registry->storage<MeshComponent>();
+    auto submit = [&](RenderCommandBucket& bucket, uint32_t slot, const MeshComponent& component) {
+      const uint32_t depth = queue.GetDepth(glm::vec3(instances[slot].Model[3]));
+      bucket.Submit(component.Mesh, slot, component.Material, component.Transparent ? RenderPass::Transparent : RenderPass::Opaque, depth);
+    };
+
+    if (culling && listed) {
+      jobs.ParallelFor(static_cast<uint32_t>(visibleSlots.size()), RecordGrain, [&](uint32_t begin, uint32_t end) {
+        RenderCommandBucket& bucket = queue.GetBucket();
+        for (uint32_t index = begin; index < end; ++index) {
+          const uint32_t slot = visibleSlots[index];
+          const MeshComponent& component = meshes.get(entities[slot]);
+          if (component.Mesh != nullptr) {
+            submit(bucket, slot, component);
+          }
+        }
+      });
+      return;
+    }
+
+    const auto& slots = registry->storage<RenderInstanceComponent>();
+    const entt::entity* meshEntities = meshes.data();
+    jobs.ParallelFor(static_cast<uint32_t>(meshes.size()), RecordGrain, [&](uint32_t begin, uint32_t end) {
+      RenderCommandBucket& bucket = queue.GetBucket();
+      for (uint32_t index = begin; index < end; ++index) {
+        const entt::entity entity = meshEntities[index];
+        const MeshComponent& component = meshes.get(entity);
+        if (component.Mesh == nullptr || !slots.contains(entity)) {
+          continue;
+        }
+        const uint32_t slot = slots.get(entity).Slot;
+        if (culling && visibility[slot] == 0u) {
+          continue;
+        }
+        submit(bucket, slot, component);
+      }
+    });
+  }
+
+
+  /**
+   * \brief Gets the statistics of the last flush.
+   * \return The extraction statistics.
+   */
+  const ExtractionStats& RenderExtractor::GetStats() const {
+    return stats;
+  }
+
+
+  /**
+   * \brief Gets the hierarchy over the world boxes of the mesh entities, whose ids are the instance slots (see GetEntity()).
+   * \details The boxes are those of the last extraction.
+   * \return The bounding volume hierarchy.
+   */
+  const BoundingVolumeHierarchy& RenderExtractor::GetHierarchy() const {
+    return hierarchy;
+  }
+
+
+  /**
+   * \brief Gets the mesh entity owning an instance slot.
+   * \param slot The slot index.
+   * \return The entity, or entt::null if the slot is free.
+   */
+  entt::entity RenderExtractor::GetEntity(uint32_t slot) const {
+    return slot < entities.size() ? entities[slot] : entt::null;
+  }
+
+
+  /**
+   * \brief Gives a slot to a new mesh entity and tags it for extraction.
+   * \param registry The registry that emitted the signal.
+   * \param entity The entity that received a MeshComponent.
+   */
+  void RenderExtractor::OnMeshConstruct(entt::registry& registry, entt::entity entity) {
+    const uint32_t slot = AllocateSlot();
+    entities[slot] = entity;
+    registry.emplace_or_replace<RenderInstanceComponent>(entity, slot);
+    registry.emplace_or_replace<DirtyTransformComponent>(entity);
+  }
+
+
+  /**
+   * \brief Removes the slot of an entity that lost its MeshComponent.
+   * \param registry The registry that emitted the signal.
+   * \param entity The entity that lost its MeshComponent.
+   */
+  void RenderExtractor::OnMeshDestroy(entt::registry& registry, entt::entity entity) {
+    // The slot itself is released by OnInstanceDestroy, which also covers the case where the entity is destroyed.
+    registry.remove<RenderInstanceComponent>(entity);
+  }
+
+
+  /**
+   * \brief Releases the slot of an entity so it can be reused.
+   * \param registry The registry that emitted the signal.
+   * \param entity The entity that lost its RenderInstanceComponent.
+   */
+  void RenderExtractor::OnInstanceDestroy(entt::registry& registry, entt::entity entity) {
+    const uint32_t slot = registry.get<RenderInstanceComponent>(entity).Slot;
+    ClearBounds(slot);
+    entities[slot] = entt::null;
+    // The component, about to be destroyed, might hold the last reference to a mesh never extracted.
+    if (const auto* mesh = registry.try_get<MeshComponent>(entity); mesh != nullptr && mesh->Mesh != nullptr) {
+      releasedMeshes.push_back(mesh->Mesh);
+    }
+    RetainMesh(slot, nullptr);
+    freeSlots.push_back(slot);
+  }
+
+
+  /**
+   * \brief Resets the model matrix of a mesh entity that lost its TransformComponent.
+   * \details The entity might be in the middle of its destruction, so the registry must not be modified here.
+   * \param registry The registry that emitted the signal.
+   * \param entity The entity that lost its TransformComponent.
+   */
+  void RenderExtractor::OnTransformDestroy(entt::registry& registry, entt::entity entity) {
+    const auto* instance = registry.try_get<RenderInstanceComponent>(entity);
+    if (instance == nullptr) {
+      return;
+    }
+    instances[instance->Slot].Model = glm::mat4(1.0f);
+    if (const auto* mesh = registry.try_get<MeshComponent>(entity); mesh != nullptr) {
+      UpdateBounds(instance->Slot, *mesh);
+    }
+    MarkDirty(instance->Slot);
+  }
+
+
+  /**
+   * \brief Tags an entity whose transform or mesh properties changed.
+   * \param registry The registry that emitted the signal.
+   * \param entity The modified entity.
+   */
+  void RenderExtractor::OnChange(entt::registry& registry, entt::entity entity) {
+    registry.emplace_or_replace<DirtyTransformComponent>(entity);
+  }
+
+
+  /**
+   * \brief Gets a free slot in the instance mirror, reusing released slots first.
+   * \return The slot index.
+   */
+  uint32_t RenderExtractor::AllocateSlot() {
+    if (!freeSlots.empty()) {
+      const uint32_t slot = freeSlots.back();
+      freeSlots.pop_back();
+      return slot;
+    }
+    instances.emplace_back();
+    dirtyFlags.push_back(0u);
+    bounds.Resize(static_cast<uint32_t>(instances.size()));
+    entities.push_back(entt::null);
+    slotMeshes.emplace_back();
+    return static_cast<uint32_t>(instances.size() - 1u);
+  }
+
+
+  /**
+   * \brief Marks a slot as needing an upload, at most once per flush.
+   * \param slot The slot index.
+   */
+  void RenderExtractor::MarkDirty(uint32_t slot) {
+    if (dirtyFlags[slot] != 0u) {
+      return;
+    }
+    dirtyFlags[slot] = 1u;
+    dirtySlots.push_back(slot);
+  }
+
+
+  /**
+   * \brief Transforms the local bounds of the mesh of a slot with its model matrix, for the culling.
+   * \param slot The slot index.
+   * \param component The mesh component of the entity, whose mesh might not be set yet.
+   */
+  void RenderExtractor::UpdateBounds(uint32_t slot, const MeshComponent& component) {
+    if (component.Mesh == nullptr) {
+      ClearBounds(slot);
+      return;
+    }
+    const MeshBounds& local = component.Mesh->GetBounds();
+    if (!local.IsBounded()) {
+      ClearBounds(slot);
+      bounds.SetUnbounded(slot);
+      unboundedSlots.push_back(slot);
+      return;
+    }
+    if (!unboundedSlots.empty()) {
+      std::erase(unboundedSlots, slot);
+    }
+    const glm::mat4& model = instances[slot].Model;
+    const BoundingBox box = local.Box.Transform(model);
+    bounds.Set(slot, box, local.Sphere.Transform(model));
+    hierarchy.Set(slot, box);
+  }
+
+
+  /**
+   * \brief Keeps a reference to the mesh of a slot, the previous one being released with the next frame.
+   * \details The simulation thread never drops the last reference to a mesh, which would destroy it without the GL context.
+   * \param slot The slot index.
+   * \param mesh The mesh of the slot, nullptr once the slot is released.
+   */
+  void RenderExtractor::RetainMesh(uint32_t slot, const Mesh3D& mesh) {
+    if (slotMeshes[slot] == mesh) {
+      return;
+    }
+    if (slotMeshes[slot] != nullptr) {
+      releasedMeshes.push_back(std::move(slotMeshes[slot]));
+    }
+    slotMeshes[slot] = mesh;
+  }
+
+
+  /**
+   * \brief Removes the bounds of a slot, which is then always culled and never found by the queries.
+   * \param slot The slot index.
+   */
+  void RenderExtractor::ClearBounds(uint32_t slot) {
+    bounds.Clear(slot);
+    hierarchy.Remove(slot);
+    if (!unboundedSlots.empty()) {
+      std::erase(unboundedSlots, slot);
+    }
+  }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file RenderExtractor.h
+ * @brief Extraction stage mirroring the mesh entities of the registry into the frame data consumed by the renderer.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "../core/TimeSlicedScheduler.h"
+#include "../ecs/ECS.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Culling.h"
+#include "FrameData.h"
+#include "RenderCommands.h"
+#include "buffers/Instance.h"
+
+namespace HeimskrEngine {
+  class JobSystem;
+
+  /**
+   * \brief Statistics of the last extraction flush.
+   */
+  struct ExtractionStats {
+    uint32_t Instances = 0u;
+    uint32_t UploadedInstances = 0u;
+    uint32_t UploadedRanges = 0u;
+    size_t UploadedBytes = 0u;
+    /**
+     * \brief Instances inside the frustum of the last culling, all the instances without culling.
+     */
+    uint32_t Visible = 0u;
+    uint32_t Culled = 0u;
+    /**
+     * \brief Instances tested one by one against the frustum, the others being accepted or rejected with a whole BVH node.
+     */
+    uint32_t Tested = 0u;
+  };
+
+
+  /**
+   * @class RenderExtractor
+   * @brief Keeps a CPU mirror of the per-instance data of every mesh entity and uploads only what changed.
+   * @details
+   * Every entity with a MeshComponent receives a persistent slot (RenderInstanceComponent) in the instance buffer.
+   * The extractor listens to the registry signals: constructing or patching a TransformComponent or a MeshComponent tags
+   * the entity with a DirtyTransformComponent. Extract() then recomputes the data of the tagged entities only and
+   * Flush() uploads the dirty slots as coalesced ranges, so the upload bandwidth scales with what moved and not with the
+   * size of the scene. Entity::Get() only hands out these components as const, so they are modified through Entity::Patch(). Entities
+   * with an InterpolatedTransformComponent are extracted every frame while they move, blended between two fixed updates.
+   * The world bounds of an instance are recomputed with its model matrix, and Cull() tests all of them against the
+   * frustum of the frame before Record(), so the commands are only recorded for the visible instances. The same
+   * bounds feed a BoundingVolumeHierarchy, refitted every frame and rebuilt in the background when it degrades, which
+   * culls large scenes by whole subtrees and answers the spatial queries of the layers (picking, proximity).
+   * The extractor keeps a reference to the mesh of every slot, so a mesh dropped by the simulation, whether its entity
+   * was visible or not, is only released by the renderer through FrameData::ReleasedMeshes.
+   */
+  class RenderExtractor {
+  public:
+    /**
+     * \brief Maximum number of clean slots allowed between two dirty slots for them to be uploaded as a single range.
+     * \details Uploading a few clean instances is cheaper than issuing an additional glBufferSubData call.
+     */
+    static constexpr uint32_t RangeMergeGap = 4u;
+
+    /**
+     * \brief Number of instances the instance buffer can hold before its first reallocation.
+     */
+    static constexpr uint32_t InitialCapacity = 1024u;
+
+    /**
+     * \brief Number of mesh entities recorded by a single job.
+     */
+    static constexpr uint32_t RecordGrain = 2048u;
+
+    /**
+     * \brief Number of instance slots tested by a single culling job, a multiple of CullingBounds::Lanes.
+     */
+    static constexpr uint32_t CullGrain = 8192u;
+
+    /**
+     * \brief Number of instances from which the culling goes through the hierarchy instead of testing every instance.
+     */
+    static constexpr uint32_t HierarchyThreshold = 4096u;
+
+    RenderExtractor() = default;
+    ~RenderExtractor();
+
+    void Connect(entt::registry& registry);
+    void Disconnect();
+    void Extract(float alpha = 1.0f);
+    void Flush(FrameData& frame);
+    void UpdateHierarchy(TimeSlicedScheduler& scheduler);
+    void Cull(const FrustumPlanes& frustum, JobSystem& jobs);
+    void Record(RenderCommandQueue& queue, JobSystem& jobs) const;
+    [[nodiscard]] const ExtractionStats& GetStats() const;
+    [[nodiscard]] const BoundingVolumeHierarchy& GetHierarchy() const;
+    [[nodiscard]] entt::entity GetEntity(uint32_t slot) const;
+
+  private:
+    void OnMeshConstruct(entt::registry& registry, entt::entity entity);
+    void OnMeshDestroy(entt::registry& registry, entt::entity entity);
+    void OnInstanceDestroy(entt::registry& registry, entt::entity entity);
+    void OnTransformDestroy(entt::registry& registry, entt::entity entity);
+    static void OnChange(entt::registry& registry, entt::entity entity);
+
+    uint32_t AllocateSlot();
+    void MarkDirty(uint32_t slot);
+    void UpdateBounds(uint32_t slot, const MeshComponent& component);
+    void RetainMesh(uint32_t slot, const Mesh3D& mesh);
+    void ClearBounds(uint32_t slot);
+
+  private:
+    entt::registry* registry = nullptr;
+    std::vector<InstanceData> instances;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> dirtySlots;
+    std::vector<uint8_t> dirtyFlags;
+    // World bounds of every slot, and the result of the last culling, valid until the next flush: the visibility of
+    // every slot when testing them all, or the list of the visible slots when culling through the hierarchy.
+    CullingBounds bounds;
+    std::vector<uint8_t> visibility;
+    std::vector<uint32_t> visibleSlots;
+    bool culling = false;
+    bool listed = false;
+    // Hierarchy over the world boxes of the slots, the slots of the meshes without bounds being kept aside.
+    BoundingVolumeHierarchy hierarchy;
+    SlicedTaskHandle rebuildTask;
+    std::vector<uint32_t> unboundedSlots;
+    std::vector<uint32_t> candidates;
+    std::vector<entt::entity> entities;
+    // Mesh of every slot at its last extraction, and the meshes to release on the GL thread with the next frame.
+    std::vector<Mesh3D> slotMeshes;
+    std::vector<Mesh3D> releasedMeshes;
+    // Capacity of the GPU instance buffer, decided here so the renderer can follow without reading the mirror.
+    uint32_t capacity = 0u;
+    ExtractionStats stats;
+  };
+}
@@ -4,10 +4,18 @@
  */
 
 #pragma once
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "../logging/Logger.h"
+#include "FrameData.h"
+#include "RenderCommands.h"
+#include "RenderExtractor.h"
 #include "buffers/Frame.h"
+#include "buffers/Geometry.h"
+#include "buffers/Instance.h"
+#include "buffers/Uniform.h"
 #include "shaders/Final.h"
 #include "shaders/PBR.h"
 
@@ -22,28 +30,184 @@ namespace HeimskrEngine {
       glewExperimental = GL_TRUE;
 
       finalShader = std::make_unique<FinalShader>("resources/shaders/final.glsl");
-      pbrShader = std::make_unique<PBRShader>("resources/shaders/pbr.glsl");
+      instancedShader = std::make_unique<PBRShader>("resources/shaders/pbr_instanced.glsl");
       frameBuffer = std::make_unique<FrameBuffer>(width, height);
+      instanceBuffer = std::make_unique<InstanceBuffer>(RenderExtractor::InitialCapacity);
+      transientBuffer = std::make_unique<TransientInstanceBuffer>(RenderExtractor::InitialCapacity);
+      batchBuffer = std::make_unique<BatchBuffer>(RenderExtractor::InitialCapacity);
+      frameUniforms = std::make_unique<UniformBuffer>(sizeof(FrameUniforms), UniformBinding::Frame);
+      viewUniforms = std::make_unique<UniformBuffer>(sizeof(ViewUniforms), UniformBinding::View);
+      geometry = GeometryArena<ShadedVertex>::Get();
+      geometry->SetInstanceBuffer(batchBuffer->GetID());
+      multiDraw = IndirectBuffer::IsSupported();
+      if (multiDraw) {
+        indirectBuffer = std::make_unique<IndirectBuffer>(RenderExtractor::InitialCapacity);
+      }
+    }
+
+
+    /**
+     * \brief Renders a frame produced by the simulation into the frame buffer.
+     * \details Must be called from the thread owning the GL context. Applies the resize, the instance and uniform uploads of the frame before executing its commands.
+     * \param frame The frame data to render.
+     */
+    void Render(const FrameData& frame) {
+      if (frame.Width > 0 && frame.Height > 0) {
+        Resize(frame.Width, frame.Height);
+      }
+      // The storage of the meshes released since the last frame can be reused.
+      geometry->Collect();
+
+      if (frame.InstanceCapacity > instanceBuffer->Capacity()) {
+        instanceBuffer->Reserve(frame.InstanceCapacity, nullptr, 0u);
+      }
+      for (const auto& range : frame.Ranges) {
+        instanceBuffer->Upload(range.First, range.Count, &frame.Instances[range.Offset]);
+      }
+
+      // The data rewritten every frame goes through the streams, fenced once the frame is submitted.
+      transientBuffer->Upload(frame.TransientInstances.data(), static_cast<uint32_t>(frame.TransientInstances.size()));
+      batchBuffer->Upload(frame.BatchInstances.data(), static_cast<uint32_t>(frame.BatchInstances.size()));
+
+      SetFrame(frame.Time, frame.DeltaTime);
+      BeginFrame();
+      if (frame.HasCamera) {
+        SetCamera(frame.Camera, frame.CameraTransform);
+      }
+      Execute(frame.Batches);
+      stats.Visible = frame.VisibleInstances;
+      stats.Culled = frame.CulledInstances;
+      EndFrame();
+      FenceStreams();
+    }
+
+
+    /**
+     * \brief Updates the per-frame uniform block read by every program.
+     * \param time The simulation time in seconds.
+     * \param deltaTime The time since the previous frame in seconds.
+     */
+    void SetFrame(double time, float deltaTime) const {
+      const auto width = static_cast<float>(frameBuffer->GetWidth());
+      const auto height = static_cast<float>(frameBuffer->GetHeight());
+      FrameUniforms uniforms;
+      uniforms.Time = glm::vec4(static_cast<float>(time), deltaTime, 0.0f, 0.0f);
+      uniforms.Resolution = glm::vec4(width, height, width > 0.0f ? 1.0f / width : 0.0f, height > 0.0f ? 1.0f / height : 0.0f);
+      frameUniforms->Upload(&uniforms, sizeof(uniforms));
     }
 
 
     /**
-     * \brief Sets the camera properties for the shader.
+     * \brief Updates the per-view uniform block read by every program, once for all of them.
      * \param camera The camera object containing the projection and view matrices.
      * \param transform The transform object containing the camera's transformation data.
      */
     void SetCamera(const Camera3D& camera, const Transform3D& transform) const {
-      pbrShader->SetCamera(camera, transform, frameBuffer->Ratio());
+      ViewUniforms uniforms;
+      uniforms.View = camera.View(transform);
+      uniforms.Projection = camera.Projection(frameBuffer->Ratio());
+      uniforms.ViewProjection = uniforms.Projection * uniforms.View;
+      uniforms.CameraPosition = glm::vec4(transform.Translation, 1.0f);
+      viewUniforms->Upload(&uniforms, sizeof(uniforms));
+    }
+
+
+    /**
+     * \brief Executes the batches of a frame, the only part of the submission that has to run on the GL thread.
+     * \details
+     * Every batch is an indirect command of the instanced PBR program (pbr_instanced.glsl), reading its mesh from the
+     * geometry arena at its first index and base vertex, and its instance indices from the batch buffer at its base
+     * instance, which includes the position of the frame in the streamed batch buffer. The batches follow the order of the sorted commands (see RenderCommand::MakeKey()), so the draws sharing
+     * their state are consecutive and every state is only set when it differs from the previous batch: the pass and
+     * the instance buffer. As every mesh lives in the same arena, a run of batches sharing their state is submitted with
+     * a single glMultiDrawElementsIndirect, or one glDrawElementsInstancedBaseVertex per batch without driver support.
+     * The number of changes and calls is kept in the statistics of the frame.
+     * \param batches The batches to execute, whose instance indices are in the batch buffer.
+     */
+    void Execute(const std::vector<RenderBatch>& batches) {
+      stats = {};
+      if (batches.empty()) {
+        return;
+      }
+      drawCommands.clear();
+      for (const auto& batch : batches) {
+        const GeometryRange& range = batch.Mesh->GetRange();
+        drawCommands.push_back({ range.IndexCount, batch.Count, range.FirstIndex, static_cast<int32_t>(range.FirstVertex), batchBuffer->GetFirst() + batch.First });
+      }
+      if (multiDraw) {
+        indirectBuffer->Upload(drawCommands.data(), static_cast<uint32_t>(drawCommands.size()));
+        indirectBuffer->Bind();
+      }
+      // The batch stream gets a new buffer object when it grows, possibly under the same name.
+      geometry->SetInstanceBuffer(batchBuffer->GetID());
+      geometry->Bind();
+
+      RenderPass pass = RenderPass::Opaque;
+      bool transient = false;
+      // The instanced PBR program, bound by BeginFrame(), is the only one so far.
+      uint32_t shader = 0u;
+      for (size_t first = 0u; first < batches.size();) {
+        const RenderBatch& batch = batches[first];
+        if (batch.Pass != pass) {
+          pass = batch.Pass;
+          SetPass(pass);
+          stats.PassChanges++;
+        }
+        if (batch.Shader != shader) {
+          shader = batch.Shader;
+          instancedShader->Bind();
+          stats.ShaderChanges++;
+        }
+        if (IsTransient(batch) != transient) {
+          transient = IsTransient(batch);
+          if (transient) {
+            instancedShader->SetInstances(*transientBuffer);
+          } else {
+            instancedShader->SetInstances(*instanceBuffer);
+          }
+          stats.InstanceBufferChanges++;
+        }
+
+        // The following batches with the same state only differ by their mesh, drawn from the same vertex array.
+        size_t last = first + 1u;
+        while (last < batches.size() && batches[last].Pass == pass && batches[last].Shader == shader && IsTransient(batches[last]) == transient) {
+          last++;
+        }
+        if (multiDraw) {
+          indirectBuffer->MultiDraw(GL_TRIANGLES, static_cast<uint32_t>(first), static_cast<uint32_t>(last - first));
+          stats.DrawCalls++;
+        } else {
+          for (size_t index = first; index < last; ++index) {
+            geometry->DrawInstanced(GL_TRIANGLES, drawCommands[index]);
+            stats.DrawCalls++;
+          }
+        }
+        for (size_t index = first; index < last; ++index) {
+          stats.Instances += batches[index].Count;
+        }
+        stats.Draws += static_cast<uint32_t>(last - first);
+        first = last;
+      }
+
+      GeometryArena<ShadedVertex>::Unbind();
+      if (multiDraw) {
+        IndirectBuffer::Unbind();
+      }
+      if (transient) {
+        instancedShader->SetInstances(*instanceBuffer);
+      }
+      if (pass != RenderPass::Opaque) {
+        SetPass(RenderPass::Opaque);
+      }
     }
 
 
     /**
-     * \brief Draws the mesh using the shader.
-     * \param mesh The mesh object to be drawn.
-     * \param transform The transform object containing the mesh's transformation data.
+     * \brief Gets the state changes of the last rendered frame.
+     * \return The render statistics.
      */
-    void Draw(const Mesh3D& mesh, const Transform3D& transform) const {
-      pbrShader->Draw(mesh, transform);
+    [[nodiscard]] const RenderStats& GetStats() const {
+      return stats;
     }
 
 
@@ -71,7 +235,8 @@ namespace HeimskrEngine {
      */
     void BeginFrame() const {
       frameBuffer->Begin();
-      pbrShader->Bind();
+      instancedShader->Bind();
+      instancedShader->SetInstances(*instanceBuffer);
     }
 
 
@@ -79,7 +244,7 @@ namespace HeimskrEngine {
      * \brief Ends the frame rendering process.
      */
     void EndFrame() const {
-      pbrShader->Unbind();
+      Shader::Unbind();
       frameBuffer->End();
     }
 
@@ -92,8 +257,57 @@ namespace HeimskrEngine {
     }
 
   private:
+    /**
+     * \brief Ends the frame of the streamed buffers, so the next frame does not overwrite the data its draws still read.
+     */
+    void FenceStreams() const {
+      transientBuffer->Fence();
+      batchBuffer->Fence();
+      if (indirectBuffer != nullptr) {
+        indirectBuffer->Fence();
+      }
+    }
+
+
+    static bool IsTransient(const RenderBatch& batch) {
+      return (batch.Flags & RenderCommand::Transient) != 0u;
+    }
+
+
+    /**
+     * \brief Sets the blending and depth writes of a pass.
+     * \param pass The pass of the next draws.
+     */
+    static void SetPass(RenderPass pass) {
+      if (pass == RenderPass::Transparent) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        return;
+      }
+      glDisable(GL_BLEND);
+      glDepthMask(GL_TRUE);
+    }
+
+  private:
+    std::unique_ptr<InstanceBuffer> instanceBuffer;
+    // Instances of the transient commands, streamed every frame.
+    std::unique_ptr<TransientInstanceBuffer> transientBuffer;
     std::unique_ptr<FrameBuffer> frameBuffer;
     std::unique_ptr<FinalShader> finalShader;
-    std::unique_ptr<PBRShader> pbrShader;
+    // Draws a whole batch per call, reading the instance of every vertex from the batch buffer.
+    std::unique_ptr<PBRShader> instancedShader;
+    // Instance indices of the batches, rewritten every frame.
+    std::unique_ptr<BatchBuffer> batchBuffer;
+    // Uniform blocks shared by every program, bound once to their binding points.
+    std::unique_ptr<UniformBuffer> frameUniforms;
+    std::unique_ptr<UniformBuffer> viewUniforms;
+    // Storage of every mesh, kept alive with the renderer so its vertex array keeps the batch buffer attribute.
+    std::shared_ptr<GeometryArena<ShadedVertex>> geometry;
+    // Indirect commands of the batches, rewritten every frame, only created when the driver supports the multi-draws.
+    std::unique_ptr<IndirectBuffer> indirectBuffer;
+    std::vector<DrawIndirectCommand> drawCommands;
+    bool multiDraw = false;
+    RenderStats stats;
   };
 }
@@ -82,6 +82,24 @@ namespace HeimskrEngine {
   }
 
 
+  /**
+   * \brief Gets the width of the framebuffer.
+   * \return The width in pixels.
+   */
+  int32_t FrameBuffer::GetWidth() const {
+    return width;
+  }
+
+
+  /**
+   * \brief Gets the height of the framebuffer.
+   * \return The height in pixels.
+   */
+  int32_t FrameBuffer::GetHeight() const {
+    return height;
+  }
+
+
   /**
    * \brief Begins the framebuffer rendering.
    */
@@ -21,6 +21,8 @@ namespace HeimskrEngine {
     [[nodiscard]] float Ratio() const;
     void Resize(int32_t width, int32_t height);
     [[nodiscard]] uint32_t GetTexture() const;
+    [[nodiscard]] int32_t GetWidth() const;
+    [[nodiscard]] int32_t GetHeight() const;
 
     void Begin() const;
     void End() const;
@@ -0,0 +1,157 @@
+/**
+ * @file Geometry.cpp
+ * @brief Implementation of the GeometryAllocator and IndirectBuffer classes.
+ */
+
+#include "Geometry.h"
+
+#include <iterator>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Constructor for the GeometryAllocator class.
+   * \param capacity The number of elements of the buffer, all free.
+   */
+  GeometryAllocator::GeometryAllocator(uint32_t capacity) {
+    Grow(capacity);
+  }
+
+
+  /**
+   * \brief Reserves a range of elements in the first free range large enough.
+   * \param count The number of elements. An empty range always succeeds without reserving anything.
+   * \param offset Receives the position of the first element of the range.
+   * \return False if no free range is large enough, the buffer having to grow.
+   */
+  bool GeometryAllocator::Allocate(uint32_t count, uint32_t& offset) {
+    if (count == 0u) {
+      offset = 0u;
+      return true;
+    }
+    for (auto block = freeBlocks.begin(); block != freeBlocks.end(); ++block) {
+      if (block->Count < count) {
+        continue;
+      }
+      offset = block->Offset;
+      block->Offset += count;
+      block->Count -= count;
+      if (block->Count == 0u) {
+        freeBlocks.erase(block);
+      }
+      used += count;
+      return true;
+    }
+    return false;
+  }
+
+
+  /**
+   * \brief Releases a range of elements reserved by Allocate().
+   * \param offset The position of the first element of the range.
+   * \param count The number of elements of the range.
+   */
+  void GeometryAllocator::Free(uint32_t offset, uint32_t count) {
+    if (count == 0u) {
+      return;
+    }
+    used -= count;
+    auto next = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), offset, [](const Block& block, uint32_t value) {
+      return block.Offset < value;
+    });
+    const bool mergePrevious = next != freeBlocks.begin() && std::prev(next)->Offset + std::prev(next)->Count == offset;
+    const bool mergeNext = next != freeBlocks.end() && offset + count == next->Offset;
+    if (mergePrevious && mergeNext) {
+      std::prev(next)->Count += count + next->Count;
+      freeBlocks.erase(next);
+    } else if (mergePrevious) {
+      std::prev(next)->Count += count;
+    } else if (mergeNext) {
+      next->Offset = offset;
+      next->Count += count;
+    } else {
+      freeBlocks.insert(next, { offset, count });
+    }
+  }
+
+
+  /**
+   * \brief Extends the buffer, the added elements being free.
+   * \param capacity The new number of elements, at least the current one.
+   */
+  void GeometryAllocator::Grow(uint32_t capacity) {
+    if (capacity <= this->capacity) {
+      return;
+    }
+    const uint32_t added = capacity - this->capacity;
+    if (!freeBlocks.empty() && freeBlocks.back().Offset + freeBlocks.back().Count == this->capacity) {
+      freeBlocks.back().Count += added;
+    } else {
+      freeBlocks.push_back({ this->capacity, added });
+    }
+    this->capacity = capacity;
+  }
+
+
+  /**
+   * \brief Constructor for the IndirectBuffer class.
+   * \param capacity The initial number of commands of a frame, grown when a frame needs more.
+   */
+  IndirectBuffer::IndirectBuffer(uint32_t capacity) : stream(capacity * sizeof(DrawIndirectCommand), sizeof(uint32_t)) {
+  }
+
+
+  /**
+   * \brief Writes the commands of the frame to the stream.
+   * \param commands The commands of the frame.
+   * \param count The number of commands.
+   */
+  void IndirectBuffer::Upload(const DrawIndirectCommand* commands, uint32_t count) {
+    if (count == 0u) {
+      return;
+    }
+    stream.Write(commands, count * sizeof(DrawIndirectCommand), offset);
+  }
+
+
+  /**
+   * \brief Binds the buffer as the source of the indirect draws.
+   */
+  void IndirectBuffer::Bind() const {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.GetID());
+  }
+
+
+  void IndirectBuffer::Unbind() {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+
+
+  /**
+   * \brief Submits consecutive commands of the last upload in a single call, reading the bound geometry arena. The buffer must be bound.
+   * \param mode The primitive mode.
+   * \param first The position of the first command in the upload.
+   * \param count The number of commands.
+   */
+  void IndirectBuffer::MultiDraw(uint32_t mode, uint32_t first, uint32_t count) const {
+    const size_t start = offset + static_cast<size_t>(first) * sizeof(DrawIndirectCommand);
+    glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, reinterpret_cast<const void*>(start), static_cast<GLsizei>(count), 0);
+  }
+
+
+  /**
+   * \brief Ends the frame, once its draws are submitted.
+   */
+  void IndirectBuffer::Fence() {
+    stream.Fence();
+  }
+
+
+  /**
+   * \brief Tells if the driver supports the multi-draws, with the base instance they need to find the instances of every batch.
+   * \details Must be called once GLEW is initialized. Without it, the commands are executed one by one with GeometryArena::DrawInstanced().
+   * \return True if IndirectBuffer::MultiDraw() can be used.
+   */
+  bool IndirectBuffer::IsSupported() {
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+  }
+}
@@ -0,0 +1,396 @@
+/**
+ * @file Geometry.h
+ * @brief Shared storage of the vertices and indices of every mesh of a vertex format, and the indirect draws reading it.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../../common/Core.h"
+#include "../../common/Types.h"
+
+#include "../../logging/Logger.h"
+#include "Stream.h"
+#include "Vertex.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Part of a geometry arena owned by a mesh, in vertices and in indices.
+   */
+  struct GeometryRange {
+    /**
+     * \brief Position of the first vertex of the mesh in the vertex buffer, added to its indices by the draws (base vertex).
+     */
+    uint32_t FirstVertex = 0u;
+    uint32_t VertexCount = 0u;
+    /**
+     * \brief Position of the first index of the mesh in the index buffer.
+     */
+    uint32_t FirstIndex = 0u;
+    uint32_t IndexCount = 0u;
+  };
+
+
+  /**
+   * \brief Parameters of a single draw of glMultiDrawElementsIndirect, laid out as GL expects them.
+   */
+  struct DrawIndirectCommand {
+    uint32_t Count = 0u;
+    uint32_t InstanceCount = 0u;
+    uint32_t FirstIndex = 0u;
+    int32_t BaseVertex = 0;
+    /**
+     * \brief Offset added to the instanced vertex attributes, the position of the batch in the batch buffer.
+     */
+    uint32_t BaseInstance = 0u;
+  };
+
+  static_assert(sizeof(DrawIndirectCommand) == 20, "DrawIndirectCommand must match the layout of DrawElementsIndirectCommand.");
+
+
+  /**
+   * @class GeometryAllocator
+   * @brief First-fit allocator of ranges of elements in a buffer, merging the neighbouring free ranges when a range is freed.
+   */
+  class GeometryAllocator {
+  public:
+    GeometryAllocator() = default;
+    GeometryAllocator(uint32_t capacity);
+
+    bool Allocate(uint32_t count, uint32_t& offset);
+    void Free(uint32_t offset, uint32_t count);
+    void Grow(uint32_t capacity);
+    [[nodiscard]] uint32_t Capacity() const { return capacity; }
+    [[nodiscard]] uint32_t Used() const { return used; }
+
+  private:
+    struct Block {
+      uint32_t Offset = 0u;
+      uint32_t Count = 0u;
+    };
+
+    // Free ranges, sorted by offset.
+    std::vector<Block> freeBlocks;
+    uint32_t capacity = 0u;
+    uint32_t used = 0u;
+  };
+
+
+  /**
+   * @class IndirectBuffer
+   * @brief GPU array of DrawIndirectCommand, streamed every frame, so a run of batches is submitted with a single glMultiDrawElementsIndirect.
+   */
+  class IndirectBuffer {
+  public:
+    IndirectBuffer() = default;
+    IndirectBuffer(uint32_t capacity);
+
+    void Upload(const DrawIndirectCommand* commands, uint32_t count);
+    void Bind() const;
+    static void Unbind();
+    void MultiDraw(uint32_t mode, uint32_t first, uint32_t count) const;
+    void Fence();
+    static bool IsSupported();
+    [[nodiscard]] uint32_t Capacity() const { return stream.Capacity() / sizeof(DrawIndirectCommand); }
+
+  private:
+    StreamBuffer stream;
+    // Offset of the commands of the last upload in the buffer, in bytes.
+    uint32_t offset = 0u;
+  };
+
+
+  /**
+   * @class GeometryArena
+   * @brief Vertex and index buffers shared by every mesh of a vertex format, under a single vertex array.
+   * @details
+   * The meshes sub-allocate their vertices and indices from the arena (see GeometryRange), so binding the vertex array
+   * of the arena once is enough to draw any of them, the draws only differing by their first index and base vertex.
+   * When the buffers are full, they are replaced by larger ones and the previous content is copied on the GPU. The
+   * arena is shared by the meshes through Get() and lives as long as one of them or the renderer holds it.
+   * The arena is GL-thread only: it must be created, used and destroyed on the thread owning the GL context, the
+   * engine releasing the meshes there. The only exception is Free(), which the destructor of a mesh can call from any
+   * thread: the freed ranges are queued and only returned to the allocators by Collect(), on the GL thread.
+   * \tparam Vertex The vertex format of the meshes.
+   */
+  template<typename Vertex>
+  class GeometryArena {
+  public:
+    static constexpr uint32_t InitialVertices = 64u * 1024u;
+    static constexpr uint32_t InitialIndices = 256u * 1024u;
+    /**
+     * \brief Location of the instanced attribute holding the instance index, see SetInstanceBuffer().
+     */
+    static constexpr uint32_t InstanceAttribute = 3u;
+
+    GeometryArena() {
+      glGenVertexArrays(1, &arrayID);
+      Reserve(InitialVertices, InitialIndices);
+    }
+
+    ~GeometryArena() {
+      glDeleteBuffers(1, &elementBufferObject);
+      glDeleteBuffers(1, &vertexBufferObject);
+      glDeleteVertexArrays(1, &arrayID);
+    }
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+
+    /**
+     * \brief Gets the arena of the vertex format, creating it when no mesh nor renderer holds it anymore.
+     * \details Must be called from the thread owning the GL context.
+     * \return The shared arena.
+     */
+    static std::shared_ptr<GeometryArena> Get() {
+      static std::weak_ptr<GeometryArena> shared;
+      std::shared_ptr<GeometryArena> arena = shared.lock();
+      if (arena == nullptr) {
+        arena = std::make_shared<GeometryArena>();
+        shared = arena;
+      }
+      return arena;
+    }
+
+
+    /**
+     * \brief Reserves the storage of a mesh, growing the buffers if needed.
+     * \param vertices The number of vertices of the mesh.
+     * \param indices The number of indices of the mesh.
+     * \return The range of the mesh, to be freed with Free().
+     */
+    GeometryRange Allocate(uint32_t vertices, uint32_t indices) {
+      Collect();
+      GeometryRange range;
+      range.VertexCount = vertices;
+      range.IndexCount = indices;
+      const bool vertexFit = vertexAllocator.Allocate(vertices, range.FirstVertex);
+      const bool indexFit = indexAllocator.Allocate(indices, range.FirstIndex);
+      if (vertexFit && indexFit) {
+        return range;
+      }
+
+      if (vertexFit) {
+        vertexAllocator.Free(range.FirstVertex, vertices);
+      }
+      if (indexFit) {
+        indexAllocator.Free(range.FirstIndex, indices);
+      }
+      Reserve(vertexFit ? vertexAllocator.Capacity() : Grown(vertexAllocator, vertices), indexFit ? indexAllocator.Capacity() : Grown(indexAllocator, indices));
+      vertexAllocator.Allocate(vertices, range.FirstVertex);
+      indexAllocator.Allocate(indices, range.FirstIndex);
+      return range;
+    }
+
+
+    /**
+     * \brief Releases the storage of a mesh. Can be called from any thread, the storage being reusable after the next Collect().
+     * \param range The range returned by Allocate().
+     */
+    void Free(const GeometryRange& range) {
+      std::lock_guard lock(freeMutex);
+      pendingFrees.push_back(range);
+    }
+
+
+    /**
+     * \brief Returns the ranges freed since the last call to the allocators. Must be called from the thread owning the GL context, e.g. once per frame.
+     */
+    void Collect() {
+      {
+        std::lock_guard lock(freeMutex);
+        collected.swap(pendingFrees);
+      }
+      for (const GeometryRange& range : collected) {
+        vertexAllocator.Free(range.FirstVertex, range.VertexCount);
+        indexAllocator.Free(range.FirstIndex, range.IndexCount);
+      }
+      collected.clear();
+    }
+
+
+    /**
+     * \brief Overwrites vertices of the arena.
+     * \param first The position of the first vertex to overwrite in the arena.
+     * \param vertices The new vertices.
+     * \param count The number of vertices to overwrite.
+     */
+    void UploadVertices(uint32_t first, const Vertex* vertices, uint32_t count) const {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBufferObject);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(Vertex), count * sizeof(Vertex), vertices);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+
+    /**
+     * \brief Overwrites indices of the arena.
+     * \details The copy target is used instead of the element array target, whose binding belongs to the bound vertex array.
+     * \param first The position of the first index to overwrite in the arena.
+     * \param indices The new indices, relative to the first vertex of their mesh.
+     * \param count The number of indices to overwrite.
+     */
+    void UploadIndices(uint32_t first, const uint32_t* indices, uint32_t count) const {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, elementBufferObject);
+      glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(uint32_t), count * sizeof(uint32_t), indices);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+
+    void Bind() const {
+      glBindVertexArray(arrayID);
+    }
+
+
+    static void Unbind() {
+      glBindVertexArray(0);
+    }
+
+
+    /**
+     * \brief Sources the instanced attribute of the arena (InstanceAttribute) from a buffer of instance indices, one per drawn instance.
+     * \details The draws of a batch then read the index of their instance at the position of the batch, given by the base instance of the draw (see DrawIndirectCommand) or by SetInstanceOffset().
+     * \param buffer The buffer object holding the instance indices, see BatchBuffer.
+     */
+    void SetInstanceBuffer(uint32_t buffer) {
+      instanceBufferObject = buffer;
+      glBindVertexArray(arrayID);
+      glEnableVertexAttribArray(InstanceAttribute);
+      glVertexAttribDivisor(InstanceAttribute, 1);
+      SetInstanceOffset(0u);
+      glBindVertexArray(0);
+    }
+
+
+    /**
+     * \brief Moves the instanced attribute to the position of a batch, for the drivers without base instance. The arena must be bound.
+     * \param first The position of the first instance index of the batch.
+     */
+    void SetInstanceOffset(uint32_t first) const {
+      glBindBuffer(GL_ARRAY_BUFFER, instanceBufferObject);
+      glVertexAttribIPointer(InstanceAttribute, 1, GL_UNSIGNED_INT, sizeof(uint32_t), reinterpret_cast<void*>(static_cast<size_t>(first) * sizeof(uint32_t)));
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+
+    /**
+     * \brief Executes an indirect command as a regular instanced draw, the fallback of IndirectBuffer::MultiDraw(). The arena must be bound.
+     * \param mode The primitive mode.
+     * \param command The draw.
+     */
+    void DrawInstanced(uint32_t mode, const DrawIndirectCommand& command) const {
+      SetInstanceOffset(command.BaseInstance);
+      glDrawElementsInstancedBaseVertex(mode, static_cast<GLsizei>(command.Count), GL_UNSIGNED_INT, reinterpret_cast<void*>(static_cast<size_t>(command.FirstIndex) * sizeof(uint32_t)),
+                                        static_cast<GLsizei>(command.InstanceCount), command.BaseVertex);
+    }
+
+
+    /**
+     * \brief Gives a new mesh an identifier, unique among the meshes of the vertex format.
+     * \return The identifier.
+     */
+    uint32_t NextMeshID() {
+      return ++meshes;
+    }
+
+  private:
+    /**
+     * \brief Gets the capacity of a buffer too fragmented or too small for a range, whose added space alone can hold the range.
+     */
+    static uint32_t Grown(const GeometryAllocator& allocator, uint32_t count) {
+      return std::max(allocator.Capacity() * 2u, allocator.Capacity() + count);
+    }
+
+
+    /**
+     * \brief Replaces the buffers with larger ones, copying their content, and points the vertex array at them.
+     * \param vertices The new vertex capacity.
+     * \param indices The new index capacity.
+     */
+    void Reserve(uint32_t vertices, uint32_t indices) {
+      if (vertices != vertexAllocator.Capacity()) {
+        vertexBufferObject = Replace(vertexBufferObject, vertexAllocator.Capacity() * sizeof(Vertex), vertices * sizeof(Vertex));
+        vertexAllocator.Grow(vertices);
+      }
+      if (indices != indexAllocator.Capacity()) {
+        elementBufferObject = Replace(elementBufferObject, indexAllocator.Capacity() * sizeof(uint32_t), indices * sizeof(uint32_t));
+        indexAllocator.Grow(indices);
+      }
+
+      // The vertex array keeps the buffer objects its attributes were set with, so they are set again.
+      glBindVertexArray(arrayID);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferObject);
+      glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+      if constexpr (TypeID<Vertex>() == TypeID<ShadedVertex>()) {
+        SetAttribute(0, 3, reinterpret_cast<void*>(offsetof(ShadedVertex, Position)));
+        SetAttribute(1, 3, reinterpret_cast<void*>(offsetof(ShadedVertex, Normal)));
+        SetAttribute(2, 2, reinterpret_cast<void*>(offsetof(ShadedVertex, UVs)));
+      }
+      else if constexpr (TypeID<Vertex>() == TypeID<UnlitVertex>()) {
+        SetAttribute(0, 3, reinterpret_cast<void*>(offsetof(UnlitVertex, Position)));
+        SetAttribute(1, 4, reinterpret_cast<void*>(offsetof(UnlitVertex, Color)));
+      }
+      else if constexpr (TypeID<Vertex>() == TypeID<QuadVertex>()) {
+        SetAttribute(0, 4, reinterpret_cast<void*>(offsetof(QuadVertex, Data)));
+      }
+      else {
+        HEIMSKR_ERROR("Unknown vertex type. Cannot create geometry arena.");
+      }
+      glBindVertexArray(0);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+
+    /**
+     * \brief Creates a buffer holding the content of another one, then deletes the other one.
+     * \param buffer The buffer to replace, 0 for none.
+     * \param size The size of the content to copy in bytes.
+     * \param capacity The size of the new buffer in bytes.
+     * \return The new buffer.
+     */
+    static uint32_t Replace(uint32_t buffer, size_t size, size_t capacity) {
+      uint32_t replacement = 0u;
+      glGenBuffers(1, &replacement);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, replacement);
+      glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STATIC_DRAW);
+      if (buffer != 0u) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(size));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+      }
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      return replacement;
+    }
+
+
+    /**
+     * \brief Sets attributes for the vertex buffer.
+     * \param index The index of the attribute to set.
+     * \param size The size of the attribute.
+     * \param value The value of the attribute.
+     */
+    static void SetAttribute(uint32_t index, int32_t size, const void* value) {
+      glEnableVertexAttribArray(index);
+      glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, sizeof(Vertex), value);
+    }
+
+  private:
+    uint32_t arrayID = 0u;
+    uint32_t vertexBufferObject = 0u;
+    uint32_t elementBufferObject = 0u;
+    uint32_t instanceBufferObject = 0u;
+    GeometryAllocator vertexAllocator;
+    GeometryAllocator indexAllocator;
+    uint32_t meshes = 0u;
+    // Ranges freed by any thread, waiting for Collect().
+    std::mutex freeMutex;
+    std::vector<GeometryRange> pendingFrees;
+    std::vector<GeometryRange> collected;
+  };
+}
@@ -0,0 +1,229 @@
+/**
+ * @file Instance.cpp
+ * @brief Implementation of the InstanceBuffer, TransientInstanceBuffer and BatchBuffer classes.
+ */
+
+#include "Instance.h"
+
+#include <algorithm>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Constructor for the InstanceBuffer class.
+   * \param capacity The initial number of instances the buffer can hold.
+   */
+  InstanceBuffer::InstanceBuffer(uint32_t capacity) {
+    glGenBuffers(1, &bufferID);
+    glGenTextures(1, &textureID);
+    Reserve(capacity, nullptr, 0u);
+  }
+
+
+  /**
+   * \brief Destructor for the InstanceBuffer class.
+   */
+  InstanceBuffer::~InstanceBuffer() {
+    glDeleteTextures(1, &textureID);
+    glDeleteBuffers(1, &bufferID);
+  }
+
+
+  /**
+   * \brief Reallocates the GPU storage with a new capacity.
+   * \details The storage is respecified, so every instance currently in use must be uploaded again through the data parameter.
+   * \param capacity The new number of instances the buffer can hold.
+   * \param data The instances to copy at the start of the new storage. Can be nullptr.
+   * \param count The number of instances in data.
+   */
+  void InstanceBuffer::Reserve(uint32_t capacity, const InstanceData* data, uint32_t count) {
+    // A texture buffer cannot be empty, so we always keep at least one instance worth of storage.
+    this->capacity = capacity == 0u ? 1u : capacity;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+    glBufferData(GL_TEXTURE_BUFFER, this->capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+    if (data != nullptr && count != 0u) {
+      glBufferSubData(GL_TEXTURE_BUFFER, 0, count * sizeof(InstanceData), data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, textureID);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, bufferID);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  }
+
+
+  /**
+   * \brief Uploads a contiguous range of instances to the GPU storage.
+   * \param first The index of the first instance to overwrite.
+   * \param count The number of instances to overwrite.
+   * \param data The new instance data, must contain at least count elements.
+   */
+  void InstanceBuffer::Upload(uint32_t first, uint32_t count, const InstanceData* data) const {
+    if (first + count > capacity) {
+      HEIMSKR_ERROR(fmt::format("Instance upload out of range: [{}, {}) for a capacity of {}", first, first + count, capacity));
+      return;
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+    glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(InstanceData), count * sizeof(InstanceData), data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+
+
+  /**
+   * \brief Binds the instance texture buffer to a texture unit.
+   * \param unit The texture unit index (0 for GL_TEXTURE0).
+   */
+  void InstanceBuffer::Bind(uint32_t unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, textureID);
+  }
+
+
+  /**
+   * \brief Gets the number of instances the GPU storage can hold.
+   * \return The capacity of the buffer in instances.
+   */
+  uint32_t InstanceBuffer::Capacity() const {
+    return capacity;
+  }
+
+
+  /**
+   * \brief Constructor for the TransientInstanceBuffer class.
+   * \param capacity The initial number of transient instances of a frame, grown when a frame needs more.
+   */
+  TransientInstanceBuffer::TransientInstanceBuffer(uint32_t capacity) : ranged(IsRangeSupported()), stream(capacity * sizeof(InstanceData), QueryAlignment(ranged), ranged) {
+    glGenTextures(1, &textureID);
+  }
+
+
+  /**
+   * \brief Destructor for the TransientInstanceBuffer class.
+   */
+  TransientInstanceBuffer::~TransientInstanceBuffer() {
+    glDeleteTextures(1, &textureID);
+  }
+
+
+  /**
+   * \brief Writes the transient instances of the frame and points the texture at them. Called once per frame.
+   * \param data The instances.
+   * \param count The number of instances.
+   */
+  void TransientInstanceBuffer::Upload(const InstanceData* data, uint32_t count) {
+    if (count == 0u) {
+      return;
+    }
+    const auto size = static_cast<uint32_t>(count * sizeof(InstanceData));
+    uint32_t offset = 0u;
+    stream.Write(data, size, offset);
+
+    glBindTexture(GL_TEXTURE_BUFFER, textureID);
+    if (ranged) {
+      glTexBufferRange(GL_TEXTURE_BUFFER, GL_RGBA32F, stream.GetID(), offset, size);
+    } else {
+      // Attached every frame, as the stream gets a new buffer object when it grows, possibly under the same name.
+      glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, stream.GetID());
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  }
+
+
+  /**
+   * \brief Binds the transient texture buffer to a texture unit.
+   * \param unit The texture unit index (0 for GL_TEXTURE0).
+   */
+  void TransientInstanceBuffer::Bind(uint32_t unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, textureID);
+  }
+
+
+  /**
+   * \brief Ends the frame, once its draws are submitted.
+   */
+  void TransientInstanceBuffer::Fence() {
+    stream.Fence();
+  }
+
+
+  /**
+   * \brief Tells if a texture buffer can cover a part of a buffer, which the persistent stream needs to move it from region to region.
+   * \return True if glTexBufferRange is available.
+   */
+  bool TransientInstanceBuffer::IsRangeSupported() {
+    return GLEW_VERSION_4_3 || GLEW_ARB_texture_buffer_range;
+  }
+
+
+  /**
+   * \brief Gets the alignment of the blocks of the stream.
+   * \param ranged True if the texture covers a range of the stream, whose offset is aligned as required by the driver.
+   * \return The alignment in bytes.
+   */
+  uint32_t TransientInstanceBuffer::QueryAlignment(bool ranged) {
+    GLint offsetAlignment = 0;
+    if (ranged) {
+      glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    }
+    return std::max(static_cast<uint32_t>(offsetAlignment), static_cast<uint32_t>(sizeof(glm::vec4)));
+  }
+
+
+  /**
+   * \brief Constructor for the BatchBuffer class.
+   * \param capacity The initial number of indices of a frame, grown when a frame needs more.
+   */
+  BatchBuffer::BatchBuffer(uint32_t capacity) : stream(capacity * sizeof(uint32_t), sizeof(uint32_t)) {
+  }
+
+
+  /**
+   * \brief Writes the indices of the frame to the stream.
+   * \param indices The instance indices of the batches of the frame.
+   * \param count The number of indices.
+   */
+  void BatchBuffer::Upload(const uint32_t* indices, uint32_t count) {
+    if (count == 0u) {
+      return;
+    }
+    uint32_t offset = 0u;
+    stream.Write(indices, count * sizeof(uint32_t), offset);
+    first = offset / sizeof(uint32_t);
+  }
+
+
+  /**
+   * \brief Ends the frame, once its draws are submitted.
+   */
+  void BatchBuffer::Fence() {
+    stream.Fence();
+  }
+
+
+  /**
+   * \brief Gets the buffer object, sourced by the instanced attribute of the geometry arena. Changes when the stream grows.
+   * \return The buffer name.
+   */
+  uint32_t BatchBuffer::GetID() const {
+    return stream.GetID();
+  }
+
+
+  /**
+   * \brief Gets the position of the indices of the last upload in the buffer, added to the base instance of the draws.
+   * \return The position in indices.
+   */
+  uint32_t BatchBuffer::GetFirst() const {
+    return first;
+  }
+
+
+  /**
+   * \brief Gets the number of indices a frame can write without growing the stream.
+   * \return The capacity of the buffer in indices.
+   */
+  uint32_t BatchBuffer::Capacity() const {
+    return stream.Capacity() / sizeof(uint32_t);
+  }
+}
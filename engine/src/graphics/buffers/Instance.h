@@ -0,0 +1,109 @@
+/**
+ * @file Instance.h
+ * @brief Per-instance render data and the GPU-side buffer that mirrors it.
+ */
+
+#pragma once
+#include <cstdint>
+
+#include "../../common/Core.h"
+
+#include "../../logging/Logger.h"
+#include "Stream.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Data uploaded to the GPU for every rendered instance.
+   * \details The layout is read by the shaders as 5 RGBA32F texels: 4 for the model matrix columns and 1 for the extra data.
+   */
+  struct InstanceData {
+    glm::mat4 Model = glm::mat4(1.0f);
+    uint32_t Material = 0u;
+    uint32_t Reserved[3] = { 0u, 0u, 0u };
+  };
+
+  static_assert(sizeof(InstanceData) == 80, "InstanceData must match the 5 texels layout expected by the shaders.");
+
+
+  /**
+   * @class InstanceBuffer
+   * @brief Persistent GPU array of InstanceData exposed to the shaders as a texture buffer (samplerBuffer).
+   */
+  class InstanceBuffer {
+  public:
+    /**
+     * \brief Number of RGBA32F texels used by a single instance.
+     */
+    static constexpr int32_t TexelsPerInstance = sizeof(InstanceData) / sizeof(glm::vec4);
+
+    InstanceBuffer() = default;
+    InstanceBuffer(uint32_t capacity);
+    ~InstanceBuffer();
+
+    void Reserve(uint32_t capacity, const InstanceData* data, uint32_t count);
+    void Upload(uint32_t first, uint32_t count, const InstanceData* data) const;
+    void Bind(uint32_t unit) const;
+    [[nodiscard]] uint32_t Capacity() const;
+
+  private:
+    uint32_t bufferID = 0u;
+    uint32_t textureID = 0u;
+    uint32_t capacity = 0u;
+  };
+
+
+  /**
+   * @class TransientInstanceBuffer
+   * @brief GPU array of the InstanceData of the transient draws of a frame, streamed and exposed to the shaders as a texture buffer (samplerBuffer).
+   * @details
+   * Written once per frame to a StreamBuffer. The texture is pointed at the block of the frame with glTexBufferRange
+   * when the driver supports it, the stream being persistently mapped. Otherwise the stream is orphaned, and the
+   * texture covers the whole buffer, whose block always starts at 0.
+   */
+  class TransientInstanceBuffer {
+  public:
+    TransientInstanceBuffer() = default;
+    TransientInstanceBuffer(uint32_t capacity);
+    ~TransientInstanceBuffer();
+
+    void Upload(const InstanceData* data, uint32_t count);
+    void Bind(uint32_t unit) const;
+    void Fence();
+
+  private:
+    static bool IsRangeSupported();
+    static uint32_t QueryAlignment(bool ranged);
+
+  private:
+    bool ranged = false;
+    StreamBuffer stream;
+    uint32_t textureID = 0u;
+  };
+
+
+  /**
+   * @class BatchBuffer
+   * @brief GPU array of the instance indices of the batches of a frame, read by the instanced shader as an instanced vertex attribute.
+   * @details
+   * Rewritten every frame, an instance costing 4 bytes instead of the 80 bytes of its InstanceData, which stays in the
+   * instance buffer. The indices are written to a StreamBuffer, whose block moves every frame (see GetFirst()). The
+   * attribute is set on the vertex array of the geometry arena (see GeometryArena::SetInstanceBuffer()), and every draw
+   * starts reading it at the position of its batch through its base instance.
+   */
+  class BatchBuffer {
+  public:
+    BatchBuffer() = default;
+    BatchBuffer(uint32_t capacity);
+
+    void Upload(const uint32_t* indices, uint32_t count);
+    void Fence();
+    [[nodiscard]] uint32_t GetID() const;
+    [[nodiscard]] uint32_t GetFirst() const;
+    [[nodiscard]] uint32_t Capacity() const;
+
+  private:
+    StreamBuffer stream;
+    // Position of the indices of the last upload in the buffer, in indices.
+    uint32_t first = 0u;
+  };
+}
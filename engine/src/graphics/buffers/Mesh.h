@@ -5,106 +5,183 @@
 
 #pragma once
 #include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
 
 #include "../../logging/Logger.h"
+#include "Geometry.h"
 #include "Vertex.h"
 #include "../../common/Types.h"
+#include "../utilities/Bounds.h"
 
 namespace HeimskrEngine {
+  /**
+   * @class Mesh
+   * @brief Vertices and indices of a mesh, stored in the geometry arena of its vertex format (see GeometryArena).
+   * @details The meshes of a format share the vertex array of their arena, so consecutive draws of different meshes do not rebind anything.
+   */
   template<typename Vertex>
   class Mesh {
   public:
     Mesh() = default;
     Mesh(const MeshData<Vertex>& data) {
-      InitializeMesh(data);
+      if (data.Vertices.empty()) {
+        HEIMSKR_ERROR("Mesh data is empty. Cannot create mesh.");
+        return;
+      }
+      InitializeMesh(static_cast<uint32_t>(data.Vertices.size()), static_cast<uint32_t>(data.Indices.size()), data.Vertices.data(), data.Indices.data());
+      bounds = MeshBounds::FromVertices(data.Vertices);
+    }
+
+    /**
+     * \brief Creates a mesh with uninitialized storage, filled afterwards through UploadVertices() and UploadIndices().
+     * \details Used to spread the upload of large meshes over several frames. The mesh is unbounded until SetBounds() is called.
+     * \param vertexCount The number of vertices of the mesh.
+     * \param indexCount The number of indices of the mesh, 0 if it is not indexed.
+     */
+    Mesh(uint32_t vertexCount, uint32_t indexCount) {
+      if (vertexCount == 0) {
+        HEIMSKR_ERROR("Mesh data is empty. Cannot create mesh.");
+        return;
+      }
+      InitializeMesh(vertexCount, indexCount, nullptr, nullptr);
     }
 
     ~Mesh() {
-      glDeleteVertexArrays(1, &bufferID);
+      if (arena != nullptr) {
+        arena->Free(range);
+      }
     }
 
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
 
     /**
      * \brief Draws the mesh with the given mode.
      * \param mode The mode to draw the mesh with. See OpenGL documentation for more information.
      */
     void Draw(uint32_t mode) const {
-      glBindVertexArray(bufferID);
-      if (indexCount != 0) {
-        glDrawElements(mode, indexCount, GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
-        return;
-      }
-      glDrawArrays(mode, 0, vertexCount);
-      glBindVertexArray(0);
+      Bind();
+      DrawBound(mode);
+      Unbind();
     }
 
-  private:
+
     /**
-     * \brief Initializes the mesh with the given data.
-     * \param data The mesh data to initialize the mesh with.
-    */
-    void InitializeMesh(const MeshData<Vertex>& data) {
-      if (data.Vertices.empty()) {
-        HEIMSKR_ERROR("Mesh data is empty. Cannot create mesh.");
-        return;
-      }
+     * \brief Binds the vertex array of the arena of the mesh, so consecutive draws of the meshes of the arena can use DrawBound().
+     */
+    void Bind() const {
+      arena->Bind();
+    }
 
-      vertexCount = static_cast<uint32_t>(data.Vertices.size());
-      indexCount = static_cast<uint32_t>(data.Indices.size());
-
-      // Note: The VAO contains the VBO and EBO (IBO) and their configuration. Used primarily for optimization purposes.
-      glGenVertexArrays(1, &bufferID);
-      glBindVertexArray(bufferID);
-
-      // Note: The VBO contains the vertex related data.
-      uint32_t vertexBufferObject = 0u;
-      glGenBuffers(1, &vertexBufferObject);
-      glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-      glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), data.Vertices.data(), GL_STATIC_DRAW);
-
-      if (indexCount != 0) {
-        // Note: The EBO (or IBO) contains the indices of the vertices to be drawn. It is used to optimize the drawing process by reducing the amount of data sent to the GPU by skipping the duplicated vertices.
-        uint32_t elementBufferObject = 0u;
-        glGenBuffers(1, &elementBufferObject);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferObject);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint32_t), data.Indices.data(), GL_STATIC_DRAW);
-      }
 
-      if (TypeID<Vertex>() == TypeID<ShadedVertex>()) {
-        SetAttribute(0, 3, reinterpret_cast<void*>(offsetof(ShadedVertex, Position)));
-        SetAttribute(1, 3, reinterpret_cast<void*>(offsetof(ShadedVertex, Normal)));
-        SetAttribute(2, 2, reinterpret_cast<void*>(offsetof(ShadedVertex, UVs)));
-      }
-      else if (TypeID<Vertex>() == TypeID<UnlitVertex>()) {
-        SetAttribute(0, 3, reinterpret_cast<void*>(offsetof(UnlitVertex, Position)));
-        SetAttribute(1, 4, reinterpret_cast<void*>(offsetof(UnlitVertex, Color)));
-      }
-      else if (TypeID<Vertex>() == TypeID<QuadVertex>()) {
-        SetAttribute(0, 4, reinterpret_cast<void*>(offsetof(QuadVertex, Data)));
-      }
-      else {
-        HEIMSKR_ERROR("Unknown vertex type. Cannot create mesh.");
+    static void Unbind() {
+      GeometryArena<Vertex>::Unbind();
+    }
+
+
+    /**
+     * \brief Draws the mesh, whose vertex array must already be bound with Bind().
+     * \param mode The mode to draw the mesh with. See OpenGL documentation for more information.
+     */
+    void DrawBound(uint32_t mode) const {
+      glDrawElementsBaseVertex(mode, static_cast<GLsizei>(range.IndexCount), GL_UNSIGNED_INT, reinterpret_cast<void*>(static_cast<size_t>(range.FirstIndex) * sizeof(uint32_t)),
+                               static_cast<GLint>(range.FirstVertex));
+    }
+
+
+    /**
+     * \brief Gets the identifier of the mesh, unique among the living meshes of its vertex format.
+     * \return The mesh identifier.
+     */
+    [[nodiscard]] uint32_t GetID() const { return meshID; }
+
+
+    /**
+     * \brief Gets the part of the geometry arena holding the mesh, to build its indirect draws.
+     * \return The range of the mesh.
+     */
+    [[nodiscard]] const GeometryRange& GetRange() const { return range; }
+
+
+    /**
+     * \brief Gets the bounding volumes of the mesh in its local space, used to cull its instances.
+     * \return The bounds of the mesh.
+     */
+    [[nodiscard]] const MeshBounds& GetBounds() const { return bounds; }
+
+
+    /**
+     * \brief Sets the bounding volumes of a mesh whose vertices are uploaded afterwards.
+     * \param meshBounds The bounds of the vertices, see MeshBounds::FromVertices().
+     */
+    void SetBounds(const MeshBounds& meshBounds) { bounds = meshBounds; }
+
+
+    /**
+     * \brief Overwrites a range of vertices of the mesh.
+     * \param first The index of the first vertex to overwrite.
+     * \param vertices The new vertices.
+     * \param count The number of vertices to overwrite.
+     */
+    void UploadVertices(uint32_t first, const Vertex* vertices, uint32_t count) const {
+      if (first + count > range.VertexCount) {
+        HEIMSKR_ERROR(fmt::format("Vertex upload out of range: {} + {} > {}", first, count, range.VertexCount));
+        return;
       }
-      glBindVertexArray(0);
+      arena->UploadVertices(range.FirstVertex + first, vertices, count);
     }
 
 
     /**
-     * \brief Sets attributes for the vertex buffer.
-     * \param index The index of the attribute to set.
-     * \param size The size of the attribute.
-     * \param value The value of the attribute.
+     * \brief Overwrites a range of indices of the mesh.
+     * \param first The position of the first index to overwrite.
+     * \param indices The new indices, relative to the first vertex of the mesh.
+     * \param count The number of indices to overwrite.
      */
-    static void SetAttribute(uint32_t index, int32_t size, const void* value) {
-      glEnableVertexAttribArray(index);
-      glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, sizeof(Vertex), value);
+    void UploadIndices(uint32_t first, const uint32_t* indices, uint32_t count) const {
+      if (first + count > range.IndexCount || !indexed) {
+        HEIMSKR_ERROR(fmt::format("Index upload out of range: {} + {} > {}", first, count, indexed ? range.IndexCount : 0u));
+        return;
+      }
+      arena->UploadIndices(range.FirstIndex + first, indices, count);
+    }
+
+  private:
+    /**
+     * \brief Reserves the storage of the mesh in the arena of its vertex format and fills it.
+     * \details A mesh without indices receives sequential ones, so every mesh is drawn with the same indexed calls.
+     * \param vertices The number of vertices of the mesh.
+     * \param indices The number of indices of the mesh.
+     * \param vertexData The initial vertices, or nullptr to leave the storage uninitialized.
+     * \param indexData The initial indices, or nullptr to leave the storage uninitialized.
+    */
+    void InitializeMesh(uint32_t vertices, uint32_t indices, const Vertex* vertexData, const uint32_t* indexData) {
+      indexed = indices != 0u;
+      arena = GeometryArena<Vertex>::Get();
+      range = arena->Allocate(vertices, indexed ? indices : vertices);
+      meshID = arena->NextMeshID();
+
+      if (vertexData != nullptr) {
+        arena->UploadVertices(range.FirstVertex, vertexData, vertices);
+      }
+      if (!indexed) {
+        std::vector<uint32_t> sequence(vertices);
+        std::iota(sequence.begin(), sequence.end(), 0u);
+        arena->UploadIndices(range.FirstIndex, sequence.data(), vertices);
+      } else if (indexData != nullptr) {
+        arena->UploadIndices(range.FirstIndex, indexData, indices);
+      }
     }
 
   private:
-    uint32_t vertexCount = 0;
-    uint32_t indexCount = 0;
-    uint32_t bufferID = 0;
+    std::shared_ptr<GeometryArena<Vertex>> arena;
+    GeometryRange range;
+    uint32_t meshID = 0u;
+    bool indexed = false;
+    MeshBounds bounds;
   };
 
   using ShadedMesh = Mesh<ShadedVertex>;
@@ -0,0 +1,209 @@
+/**
+ * @file Stream.cpp
+ * @brief Implementation of the StreamBuffer class.
+ */
+
+#include "Stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace HeimskrEngine {
+  /**
+   * \brief Constructor for the StreamBuffer class.
+   * \param capacity The initial size of a region in bytes, grown when a frame needs more.
+   * \param alignment The alignment of the blocks in bytes, e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform ranges.
+   * \param allowPersistent False to always orphan, for the users that cannot read a block at any offset.
+   */
+  StreamBuffer::StreamBuffer(uint32_t capacity, uint32_t alignment, bool allowPersistent) : alignment(std::max(alignment, 1u)) {
+    persistent = allowPersistent && IsPersistentSupported();
+    Allocate(capacity);
+  }
+
+
+  /**
+   * \brief Destructor for the StreamBuffer class.
+   */
+  StreamBuffer::~StreamBuffer() {
+    Release();
+  }
+
+
+  /**
+   * \brief Reserves a block of the region of the frame and maps it for writing.
+   * \details
+   * Unmap() must be called before the block is read by the GPU and before the next Map(). The first block of a frame
+   * grows the buffer at once if needed. The next ones cannot, since the blocks already written are read from the
+   * current buffer: a block that does not fit is refused, and the buffer grows when the frame is fenced.
+   * \param size The size of the block in bytes, greater than 0.
+   * \param offset Receives the offset of the block in the buffer, where the GPU reads it.
+   * \return The pointer to the block, only written to, or nullptr if the block does not fit in the region of the frame or could not be mapped, in which case Unmap() must not be called.
+   */
+  uint8_t* StreamBuffer::Map(uint32_t size, uint32_t& offset) {
+    const uint32_t aligned = (size + alignment - 1u) / alignment * alignment;
+    if (head + aligned > capacity) {
+      if (head != 0u) {
+        required = std::max(required, head + aligned);
+        HEIMSKR_ERROR(fmt::format("A stream buffer frame needs {} bytes, more than its region of {} bytes. The region grows on the next frame.", head + aligned, capacity));
+        return nullptr;
+      }
+      Release();
+      Allocate(std::max(capacity * 2u, aligned));
+    }
+
+    if (persistent) {
+      if (head == 0u) {
+        Wait(fences[region], stalls);
+      }
+      offset = region * capacity + head;
+      head += aligned;
+      return mapped + offset;
+    }
+
+    offset = head;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+    if (head == 0u) {
+      // Orphaning: the driver gives new storage to the buffer, the draws of the previous frames keeping the old one.
+      glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    }
+    // Nothing of the frame read this block yet, so there is nothing to synchronize with.
+    auto* pointer = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    head += aligned;
+    return pointer;
+  }
+
+
+  /**
+   * \brief Ends the writes to the block returned by Map(). The persistent mapping being coherent, it only unmaps the orphaned buffers.
+   */
+  void StreamBuffer::Unmap() {
+    if (persistent) {
+      return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+
+  /**
+   * \brief Copies data to a new block of the frame.
+   * \param data The data to copy.
+   * \param size The size of the data in bytes, greater than 0.
+   * \param offset Receives the offset of the block in the buffer.
+   * \return False if the block did not fit in the region of the frame (see Map()), or could not be mapped.
+   */
+  bool StreamBuffer::Write(const void* data, uint32_t size, uint32_t& offset) {
+    uint8_t* pointer = Map(size, offset);
+    if (pointer == nullptr) {
+      return false;
+    }
+    std::memcpy(pointer, data, size);
+    Unmap();
+    return true;
+  }
+
+
+  /**
+   * \brief Ends the frame, once the draws reading its blocks are submitted, so the next frame writes to the next region.
+   * \details The region of the frame is fenced, and will be waited for when the ring comes back to it. If a block of the frame was refused, the buffer is replaced by one whose regions hold the whole frame, the draws already submitted keeping the old one alive.
+   */
+  void StreamBuffer::Fence() {
+    if (head == 0u) {
+      return;
+    }
+    head = 0u;
+    if (persistent) {
+      fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      region = (region + 1u) % Regions;
+    }
+    if (required > capacity) {
+      Release();
+      Allocate(std::max(capacity * 2u, required));
+    }
+    required = 0u;
+  }
+
+
+  /**
+   * \brief Tells if the driver supports the persistent mapping.
+   * \details Must be called once GLEW is initialized.
+   * \return True if the buffers are persistently mapped, false if they are orphaned.
+   */
+  bool StreamBuffer::IsPersistentSupported() {
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+  }
+
+
+  /**
+   * \brief Creates the buffer, mapping it for good when persistent.
+   * \param regionCapacity The size of a region in bytes.
+   */
+  void StreamBuffer::Allocate(uint32_t regionCapacity) {
+    capacity = (std::max(regionCapacity, alignment) + alignment - 1u) / alignment * alignment;
+    region = 0u;
+    head = 0u;
+
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+    if (persistent) {
+      constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity) * Regions, nullptr, flags);
+      mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(capacity) * Regions, flags));
+      if (mapped == nullptr) {
+        HEIMSKR_ERROR("Persistent mapping of a stream buffer failed. Falling back to orphaning.");
+        glDeleteBuffers(1, &bufferID);
+        glGenBuffers(1, &bufferID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+        persistent = false;
+      }
+    }
+    if (!persistent) {
+      glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+
+  /**
+   * \brief Deletes the buffer and its fences.
+   */
+  void StreamBuffer::Release() {
+    for (GLsync& fence : fences) {
+      if (fence != nullptr) {
+        glDeleteSync(fence);
+        fence = nullptr;
+      }
+    }
+    if (mapped != nullptr) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      mapped = nullptr;
+    }
+    glDeleteBuffers(1, &bufferID);
+    bufferID = 0u;
+  }
+
+
+  /**
+   * \brief Waits until the GPU passed a fence, then deletes it.
+   * \param fence The fence, nullptr if the region was never fenced.
+   * \param stalls The stall counter, increased if the fence was not passed yet.
+   */
+  void StreamBuffer::Wait(GLsync& fence, uint64_t& stalls) {
+    if (fence == nullptr) {
+      return;
+    }
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+      stalls++;
+      do {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WaitTimeout);
+      } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+}
@@ -0,0 +1,81 @@
+/**
+ * @file Stream.h
+ * @brief Ring buffer for the data rewritten every frame, persistently mapped when the driver allows it.
+ */
+
+#pragma once
+#include <cstdint>
+
+#include "../../common/Core.h"
+
+#include "../../logging/Logger.h"
+
+namespace HeimskrEngine {
+  /**
+   * @class StreamBuffer
+   * @brief GPU buffer the data of every frame is written to through a pointer, without glBufferData nor glBufferSubData.
+   * @details
+   * With GL_ARB_buffer_storage, the buffer holds Regions regions of the same size and is mapped once, persistently and
+   * coherently. Every frame writes to its own region while the GPU may still read the regions of the previous frames,
+   * and Fence() places a fence sync after the draws of the frame, waited before the region is written again. Without
+   * it, the buffer holds a single region orphaned at the first write of every frame, the driver handing out new storage
+   * while the previous one is read. A frame can write several blocks (Map()), placed one after the other in its region.
+   * The region grows before the first block of a frame, or once the frame is fenced if a later block did not fit, so
+   * the blocks of a frame always share the buffer of GetID(). The mapped pointer can be filled by any thread before Unmap().
+   */
+  class StreamBuffer {
+  public:
+    /**
+     * \brief Number of regions of a persistent buffer: one written by the CPU, up to two read by the GPU.
+     */
+    static constexpr uint32_t Regions = 3u;
+    /**
+     * \brief Time between two checks of a fence while waiting for the GPU, in nanoseconds.
+     */
+    static constexpr uint64_t WaitTimeout = 1000000u;
+
+    StreamBuffer() = default;
+    StreamBuffer(uint32_t capacity, uint32_t alignment, bool allowPersistent = true);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    uint8_t* Map(uint32_t size, uint32_t& offset);
+    void Unmap();
+    bool Write(const void* data, uint32_t size, uint32_t& offset);
+    void Fence();
+    static bool IsPersistentSupported();
+
+    [[nodiscard]] uint32_t GetID() const { return bufferID; }
+    [[nodiscard]] bool IsPersistent() const { return persistent; }
+    /**
+     * \brief Gets the size of a region in bytes, the most a frame can write without growing the buffer.
+     */
+    [[nodiscard]] uint32_t Capacity() const { return capacity; }
+    /**
+     * \brief Gets the number of times a frame had to wait for the GPU to release its region.
+     */
+    [[nodiscard]] uint64_t GetStalls() const { return stalls; }
+
+  private:
+    void Allocate(uint32_t regionCapacity);
+    void Release();
+    static void Wait(GLsync& fence, uint64_t& stalls);
+
+  private:
+    uint32_t bufferID = 0u;
+    uint32_t capacity = 0u;
+    uint32_t alignment = 16u;
+    bool persistent = false;
+    // Persistent buffers: the whole mapped buffer, the region of the frame and the fence of every region.
+    uint8_t* mapped = nullptr;
+    uint32_t region = 0u;
+    GLsync fences[Regions] = {};
+    // Offset of the next block of the frame in its region.
+    uint32_t head = 0u;
+    // Size the frame needed when one of its blocks was refused, the buffer growing to it once fenced.
+    uint32_t required = 0u;
+    uint64_t stalls = 0u;
+  };
+}
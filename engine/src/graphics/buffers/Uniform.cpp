@@ -0,0 +1,45 @@
+/**
+ * @file Uniform.cpp
+ * @brief Implementation of the UniformBuffer class.
+ */
+
+#include "Uniform.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Constructor for the UniformBuffer class.
+   * \param size The size of the uniform block in bytes.
+   * \param binding The binding point the buffer is bound to, see UniformBinding.
+   */
+  UniformBuffer::UniformBuffer(uint32_t size, uint32_t binding) : size(size) {
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, bufferID);
+  }
+
+
+  /**
+   * \brief Destructor for the UniformBuffer class.
+   */
+  UniformBuffer::~UniformBuffer() {
+    glDeleteBuffers(1, &bufferID);
+  }
+
+
+  /**
+   * \brief Replaces the content of the uniform block.
+   * \param data The new data of the block.
+   * \param size The size of the data, at most the size of the buffer.
+   */
+  void UniformBuffer::Upload(const void* data, uint32_t size) const {
+    if (size > this->size) {
+      HEIMSKR_ERROR(fmt::format("Uniform upload of {} bytes into a block of {} bytes", size, this->size));
+      return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+/**
+ * @file Uniform.h
+ * @brief std140 uniform blocks shared by every shader program, and the buffers holding them.
+ */
+
+#pragma once
+#include <cstdint>
+
+#include "../../common/Core.h"
+
+#include "../../logging/Logger.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Binding points of the uniform blocks, the same for every program (see Shader::BindUniformBlocks()).
+   */
+  struct UniformBinding {
+    /**
+     * \brief Block "FrameBlock", holding FrameUniforms.
+     */
+    static constexpr uint32_t Frame = 0u;
+    /**
+     * \brief Block "ViewBlock", holding ViewUniforms.
+     */
+    static constexpr uint32_t View = 1u;
+  };
+
+
+  /**
+   * \brief Data of the FrameBlock uniform block, updated once per frame. Laid out as std140.
+   */
+  struct FrameUniforms {
+    /**
+     * \brief Simulation time in seconds, then the time since the last frame, the other components being unused.
+     */
+    glm::vec4 Time = glm::vec4(0.0f);
+    /**
+     * \brief Size of the frame buffer in pixels, then its inverse.
+     */
+    glm::vec4 Resolution = glm::vec4(0.0f);
+  };
+
+  static_assert(sizeof(FrameUniforms) == 32, "FrameUniforms must match the std140 layout of FrameBlock.");
+
+
+  /**
+   * \brief Data of the ViewBlock uniform block, updated once per view. Laid out as std140.
+   */
+  struct ViewUniforms {
+    glm::mat4 View = glm::mat4(1.0f);
+    glm::mat4 Projection = glm::mat4(1.0f);
+    glm::mat4 ViewProjection = glm::mat4(1.0f);
+    /**
+     * \brief Position of the camera in world space, w being unused.
+     */
+    glm::vec4 CameraPosition = glm::vec4(0.0f);
+  };
+
+  static_assert(sizeof(ViewUniforms) == 208, "ViewUniforms must match the std140 layout of ViewBlock.");
+
+
+  /**
+   * @class UniformBuffer
+   * @brief Uniform buffer bound once to a fixed binding point, so every program reads it without any per-program call.
+   */
+  class UniformBuffer {
+  public:
+    UniformBuffer() = default;
+    UniformBuffer(uint32_t size, uint32_t binding);
+    ~UniformBuffer();
+
+    void Upload(const void* data, uint32_t size) const;
+
+  private:
+    uint32_t bufferID = 0u;
+    uint32_t size = 0u;
+  };
+}
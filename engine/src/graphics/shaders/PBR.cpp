@@ -7,31 +7,26 @@
 
 namespace HeimskrEngine {
   PBRShader::PBRShader(const std::string& filename) : Shader(filename) {
-    u_Model = glGetUniformLocation(shaderID, "u_model");
-    u_View = glGetUniformLocation(shaderID, "u_view");
-    u_Projection = glGetUniformLocation(shaderID, "u_projection");
+    u_Instances = glGetUniformLocation(shaderID, "u_instances");
   }
 
 
   /**
-   * \brief Sets the camera properties for the shader.
-   * \param camera The camera object containing the projection and view matrices.
-   * \param transform The transform object containing the camera's transformation data.
-   * \param ratio The aspect ratio of the viewport (width/height).
+   * \brief Binds the instance buffer the model matrices are fetched from.
+   * \param instances The instance buffer filled by the render extraction stage.
    */
-  void PBRShader::SetCamera(const Camera3D& camera, const Transform3D& transform, float ratio) const {
-    glUniformMatrix4fv(u_Projection, 1, GL_FALSE, glm::value_ptr(camera.Projection(ratio)));
-    glUniformMatrix4fv(u_View, 1, GL_FALSE, glm::value_ptr(camera.View(transform)));
+  void PBRShader::SetInstances(const InstanceBuffer& instances) const {
+    instances.Bind(0);
+    glUniform1i(u_Instances, 0);
   }
 
 
   /**
-   * \brief Draws the mesh using the shader.
-   * \param mesh The mesh object to be drawn.
-   * \param transform The transform object containing the mesh's transformation data.
+   * \brief Binds the transient instances of the frame, for the draws of the transient commands.
+   * \param instances The transient instance buffer of the frame.
    */
-  void PBRShader::Draw(const Mesh3D& mesh, const Transform3D& transform) const {
-    glUniformMatrix4fv(u_Model, 1, GL_FALSE, glm::value_ptr(transform.Matrix()));
-    mesh->Draw(GL_TRIANGLES);
+  void PBRShader::SetInstances(const TransientInstanceBuffer& instances) const {
+    instances.Bind(0);
+    glUniform1i(u_Instances, 0);
   }
 }
@@ -7,6 +7,7 @@
 
 #include "Shader.h"
 #include "../ecs/ECS.h"
+#include "../buffers/Instance.h"
 
 #include "../utility/GLGetError.h"
 
@@ -20,13 +21,11 @@ namespace HeimskrEngine {
     PBRShader() = default;
     PBRShader(const std::string& filename);
 
-    void SetCamera(const Camera3D& camera, const Transform3D& transform, float ratio) const;
-    void Draw(const Mesh3D& mesh, const Transform3D& transform) const;
+    void SetInstances(const InstanceBuffer& instances) const;
+    void SetInstances(const TransientInstanceBuffer& instances) const;
 
   private:
-    GLint u_Model = 0u;
-    GLint u_View = 0u;
-    GLint u_Projection = 0u;
+    GLint u_Instances = 0u;
   };
 }
 
@@ -5,9 +5,14 @@
 
 #include "Shader.h"
 
+#include <utility>
+
+#include "../buffers/Uniform.h"
+
 namespace HeimskrEngine {
   Shader::Shader(const std::string& filename) {
     shaderID = Load(filename);
+    BindUniformBlocks(shaderID);
   }
 
   Shader::~Shader() {
@@ -126,4 +131,26 @@ namespace HeimskrEngine {
     }
     return 0;
   }
-}
+
+
+  /**
+   * \brief Assigns the uniform blocks declared by a program to their binding points, so the buffers bound once by the
+   * renderer are shared by every program. GLSL 3.30 has no binding layout qualifier, hence the blocks are matched by name.
+   * \param programID The ID of the linked program.
+   */
+  void Shader::BindUniformBlocks(uint32_t programID) {
+    if (programID == 0u) {
+      return;
+    }
+    constexpr std::pair<const char*, uint32_t> blocks[] = {
+      { "FrameBlock", UniformBinding::Frame },
+      { "ViewBlock", UniformBinding::View }
+    };
+    for (const auto& [name, binding] : blocks) {
+      const uint32_t index = glGetUniformBlockIndex(programID, name);
+      if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(programID, index, binding);
+      }
+    }
+  }
+}
\ No newline at end of file
@@ -26,6 +26,7 @@ namespace HeimskrEngine {
     static uint32_t Build(const char* shaderSource, uint32_t type);
     static uint32_t Link(uint32_t vertexShader, uint32_t fragmentShader);
     static uint32_t Load(const std::string& filename);
+    static void BindUniformBlocks(uint32_t programID);
 
   protected:
     uint32_t shaderID = 0u;
@@ -0,0 +1,173 @@
+/**
+ * @file Bounds.h
+ * @brief Bounding volumes of the meshes and the frustum planes they are tested against.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#include "../GLMCommon.h"
+
+namespace HeimskrEngine {
+  /**
+   * \brief Axis-aligned bounding box, stored as its center and its half size.
+   */
+  struct BoundingBox {
+    glm::vec3 Center = glm::vec3(0.0f);
+    glm::vec3 Extents = glm::vec3(0.0f);
+
+    /**
+     * \brief Transforms the box, giving the axis-aligned box enclosing the transformed box.
+     * \param matrix The transformation matrix, usually the model matrix of an instance.
+     * \return The transformed box.
+     */
+    [[nodiscard]] BoundingBox Transform(const glm::mat4& matrix) const {
+      const glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+      return { glm::vec3(matrix * glm::vec4(Center, 1.0f)), absolute * Extents };
+    }
+
+
+    /**
+     * \brief Grows the box so it encloses another box.
+     * \param other The box to enclose.
+     */
+    void Merge(const BoundingBox& other) {
+      const glm::vec3 minimum = glm::min(Center - Extents, other.Center - other.Extents);
+      const glm::vec3 maximum = glm::max(Center + Extents, other.Center + other.Extents);
+      Center = (minimum + maximum) * 0.5f;
+      Extents = (maximum - minimum) * 0.5f;
+    }
+
+
+    [[nodiscard]] glm::vec3 Min() const { return Center - Extents; }
+    [[nodiscard]] glm::vec3 Max() const { return Center + Extents; }
+  };
+
+
+  /**
+   * \brief Bounding sphere.
+   */
+  struct BoundingSphere {
+    glm::vec3 Center = glm::vec3(0.0f);
+    float Radius = 0.0f;
+
+    /**
+     * \brief Transforms the sphere, scaling its radius by the largest scale of the matrix.
+     * \param matrix The transformation matrix, usually the model matrix of an instance.
+     * \return The transformed sphere.
+     */
+    [[nodiscard]] BoundingSphere Transform(const glm::mat4& matrix) const {
+      const float scale = std::max({ glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])) });
+      return { glm::vec3(matrix * glm::vec4(Center, 1.0f)), Radius * scale };
+    }
+  };
+
+
+  /**
+   * \brief Bounding volumes of a mesh in its local space, computed once from its vertices.
+   * \details Default constructed bounds are unbounded, so a mesh whose vertices are unknown is never culled.
+   */
+  struct MeshBounds {
+    BoundingBox Box = { glm::vec3(0.0f), glm::vec3(FLT_MAX) };
+    BoundingSphere Sphere = { glm::vec3(0.0f), FLT_MAX };
+
+    /**
+     * \brief Computes the bounds of a set of vertices.
+     * \details The sphere is centered on the box, which is close to the minimal sphere for the usual meshes and keeps the computation linear.
+     * \tparam Vertex The vertex type. Vertices without a Position member give unbounded bounds.
+     * \param vertices The vertices of the mesh.
+     * \return The bounds of the vertices.
+     */
+    template<typename Vertex>
+    [[nodiscard]] static MeshBounds FromVertices(const std::vector<Vertex>& vertices) {
+      MeshBounds bounds;
+      if constexpr (requires(const Vertex& vertex) { glm::vec3(vertex.Position); }) {
+        if (vertices.empty()) {
+          return bounds;
+        }
+        glm::vec3 minimum = glm::vec3(vertices.front().Position);
+        glm::vec3 maximum = minimum;
+        for (const Vertex& vertex : vertices) {
+          minimum = glm::min(minimum, glm::vec3(vertex.Position));
+          maximum = glm::max(maximum, glm::vec3(vertex.Position));
+        }
+        bounds.Box = { (minimum + maximum) * 0.5f, (maximum - minimum) * 0.5f };
+
+        float radius = 0.0f;
+        for (const Vertex& vertex : vertices) {
+          radius = std::max(radius, glm::length(glm::vec3(vertex.Position) - bounds.Box.Center));
+        }
+        bounds.Sphere = { bounds.Box.Center, radius };
+      }
+      return bounds;
+    }
+
+
+    [[nodiscard]] bool IsBounded() const { return Sphere.Radius != FLT_MAX; }
+  };
+
+
+  /**
+   * \brief The 6 planes of a view frustum, pointing inwards, for the visibility tests.
+   */
+  struct FrustumPlanes {
+    enum Plane { Left, Right, Bottom, Top, Near, Far, Count };
+
+    /**
+     * \brief Extracts the planes from a view-projection matrix (Gribb and Hartmann), see Camera3D::Frustum().
+     * \details The planes are normalized so the signed distances they give are in world units, as needed by the sphere tests.
+     * \param frustum The view-projection matrix of the view.
+     * \return The planes of the view, in world space.
+     */
+    [[nodiscard]] static FrustumPlanes FromMatrix(const glm::mat4& frustum) {
+      const glm::mat4 rows = glm::transpose(frustum);
+      FrustumPlanes planes;
+      planes.Planes[Left] = rows[3] + rows[0];
+      planes.Planes[Right] = rows[3] - rows[0];
+      planes.Planes[Bottom] = rows[3] + rows[1];
+      planes.Planes[Top] = rows[3] - rows[1];
+      planes.Planes[Near] = rows[3] + rows[2];
+      planes.Planes[Far] = rows[3] - rows[2];
+      for (glm::vec4& plane : planes.Planes) {
+        plane /= glm::length(glm::vec3(plane));
+      }
+      return planes;
+    }
+
+
+    /**
+     * \brief Tells if a sphere is at least partly inside the frustum.
+     * \param sphere The sphere in world space.
+     * \return False if the sphere is entirely outside a plane.
+     */
+    [[nodiscard]] bool Intersects(const BoundingSphere& sphere) const {
+      for (const glm::vec4& plane : Planes) {
+        if (glm::dot(glm::vec3(plane), sphere.Center) + plane.w < -sphere.Radius) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+
+    /**
+     * \brief Tells if a box is at least partly inside the frustum.
+     * \details Conservative: a box near a corner of the frustum can be outside while crossing every plane.
+     * \param box The box in world space.
+     * \return False if the box is entirely outside a plane.
+     */
+    [[nodiscard]] bool Intersects(const BoundingBox& box) const {
+      for (const glm::vec4& plane : Planes) {
+        const float radius = glm::dot(glm::abs(glm::vec3(plane)), box.Extents);
+        if (glm::dot(glm::vec3(plane), box.Center) + plane.w < -radius) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    glm::vec4 Planes[Count];
+  };
+}
@@ -27,6 +27,28 @@ namespace HeimskrEngine {
       return translationMatrix * rotationMatrix * scaleMatrix;
     }
 
+    /**
+     * \brief Blends two transformations, used to render a state between two simulation ticks.
+     * \param from The transformation at the previous tick.
+     * \param to The transformation at the last tick.
+     * \param alpha The blend factor in [0, 1], 0 giving from and 1 giving to.
+     * \return The interpolated transformation.
+     */
+    [[nodiscard]] static Transform3D Interpolate(const Transform3D& from, const Transform3D& to, float alpha) {
+      Transform3D result;
+      result.Translation = glm::mix(from.Translation, to.Translation, alpha);
+      result.Scale = glm::mix(from.Scale, to.Scale, alpha);
+      // The rotations are blended as quaternions, the Euler angles would not take the shortest path.
+      const glm::quat rotation = glm::slerp(glm::quat(glm::radians(from.Rotation)), glm::quat(glm::radians(to.Rotation)), alpha);
+      result.Rotation = glm::degrees(glm::eulerAngles(rotation));
+      return result;
+    }
+
+
+    [[nodiscard]] bool operator==(const Transform3D& other) const {
+      return Translation == other.Translation && Rotation == other.Rotation && Scale == other.Scale;
+    }
+
     glm::vec3 Translation = glm::vec3(0.0f);
     glm::vec3 Rotation = glm::vec3(0.0f);
     glm::vec3 Scale = glm::vec3(1.0f);
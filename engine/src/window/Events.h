@@ -66,4 +66,60 @@ namespace HeimskrEngine {
     double ScrollY = 0.0;
   };
 
+  HEIMSKR_RECORDABLE_EVENT(WindowMaximizeEvent);
+  HEIMSKR_RECORDABLE_EVENT(WindowIconifyEvent);
+  HEIMSKR_RECORDABLE_EVENT(WindowRestoreEvent);
+  HEIMSKR_RECORDABLE_EVENT(WindowCloseEvent);
+  HEIMSKR_RECORDABLE_EVENT(WindowResizeEvent);
+  HEIMSKR_RECORDABLE_EVENT(KeyReleaseEvent);
+  HEIMSKR_RECORDABLE_EVENT(KeyPressEvent);
+  HEIMSKR_RECORDABLE_EVENT(KeyRepeatEvent);
+  HEIMSKR_RECORDABLE_EVENT(MouseReleaseEvent);
+  HEIMSKR_RECORDABLE_EVENT(MouseDownEvent);
+  HEIMSKR_RECORDABLE_EVENT(MouseDragEvent);
+  HEIMSKR_RECORDABLE_EVENT(MouseMotionEvent);
+  HEIMSKR_RECORDABLE_EVENT(MouseWheelEvent);
+
+  /**
+   * \brief Only the last size of an interactive resize is delivered, so the frame buffer is reallocated once per frame.
+   */
+  template<>
+  struct EventCoalescing<WindowResizeEvent> {
+    static constexpr CoalescePolicy Policy = CoalescePolicy::KeepLast;
+  };
+
+  /**
+   * \brief Only the last cursor position is delivered, high polling rate mice reporting several per frame.
+   */
+  template<>
+  struct EventCoalescing<MouseMotionEvent> {
+    static constexpr CoalescePolicy Policy = CoalescePolicy::KeepLast;
+  };
+
+  /**
+   * \brief The drag deltas of a frame are summed into a single drag.
+   */
+  template<>
+  struct EventCoalescing<MouseDragEvent> {
+    static constexpr CoalescePolicy Policy = CoalescePolicy::SumDeltas;
+
+    static void Accumulate(MouseDragEvent& total, const MouseDragEvent& event) {
+      total.DeltaX += event.DeltaX;
+      total.DeltaY += event.DeltaY;
+    }
+  };
+
+  /**
+   * \brief The scroll offsets of a frame are summed into a single wheel event.
+   */
+  template<>
+  struct EventCoalescing<MouseWheelEvent> {
+    static constexpr CoalescePolicy Policy = CoalescePolicy::SumDeltas;
+
+    static void Accumulate(MouseWheelEvent& total, const MouseWheelEvent& event) {
+      total.ScrollX += event.ScrollX;
+      total.ScrollY += event.ScrollY;
+    }
+  };
+
 }
@@ -73,11 +73,46 @@ namespace HeimskrEngine {
   bool Window::PollEvents() const {
     glfwPollEvents();
     dispatcher->PollEvents();
-    glfwSwapBuffers(windowHandle); // Swap the front buffer and back buffer for rendering the back buffer. See double-buffered rendering for more details.
     return !glfwWindowShouldClose(windowHandle);
   }
 
 
+  /**
+   * \brief Swaps the front buffer and back buffer for rendering the back buffer. See double-buffered rendering for more details.
+   * \details Can be called from the thread owning the GL context, which is not necessarily the main thread.
+   */
+  void Window::SwapBuffers() const {
+    glfwSwapBuffers(windowHandle);
+  }
+
+
+  /**
+   * \brief Makes the GL context of the window current on the calling thread.
+   * \details The context must not be current on any other thread, see ReleaseContext().
+   */
+  void Window::MakeContextCurrent() const {
+    glfwMakeContextCurrent(windowHandle);
+  }
+
+
+  /**
+   * \brief Enables or disables the synchronization of the buffer swaps with the monitor refresh rate.
+   * \details Must be called from the thread owning the GL context. The simulation rate does not depend on it.
+   * \param enabled True to wait for the vertical blank before swapping the buffers.
+   */
+  void Window::SetVSync(bool enabled) const {
+    glfwSwapInterval(enabled ? 1 : 0);
+  }
+
+
+  /**
+   * \brief Detaches the current GL context from the calling thread, so another thread can make it current.
+   */
+  void Window::ReleaseContext() {
+    glfwMakeContextCurrent(nullptr);
+  }
+
+
   /**
    * \brief Checks if a key is pressed
    * \param key The key to check
@@ -16,6 +16,10 @@ namespace HeimskrEngine {
     ~Window();
 
     bool PollEvents() const;
+    void SwapBuffers() const;
+    void MakeContextCurrent() const;
+    static void ReleaseContext();
+    void SetVSync(bool enabled) const;
     bool IsKey(int32_t key) const;
     bool IsMouse(int32_t button) const;
     GLFWwindow* GetWindowHandle() const { return windowHandle; }
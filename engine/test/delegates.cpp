@@ -0,0 +1,68 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+
+#include "../src/common/Event.h"
+
+namespace {
+  template<typename Function>
+  double MeasureNanoseconds(uint32_t iterations, Function&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t iteration = 0u; iteration < iterations; ++iteration) {
+      function(iteration);
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+  }
+
+
+  /**
+   * \brief Creates, calls and destroys a callable capturing Size bytes, through std::function and through Delegate.
+   */
+  template<size_t Size>
+  void BenchmarkCapture(uint32_t iterations) {
+    std::array<uint8_t, Size> capture {};
+    capture[0] = 1u;
+    uint64_t sum = 0u;
+
+    auto make = [&] { return [capture, &sum](uint32_t value) { sum += capture[0] + value; }; };
+    using Lambda = decltype(make());
+
+    const double function = MeasureNanoseconds(iterations, [&](uint32_t iteration) {
+      std::function<void(uint32_t)> callback = make();
+      callback(iteration);
+    });
+    const double delegate = MeasureNanoseconds(iterations, [&](uint32_t iteration) {
+      HeimskrEngine::Delegate<void(uint32_t)> callback = make();
+      callback(iteration);
+    });
+
+    std::cout << sizeof(Lambda) << " bytes capture: std::function " << function << " ns, Delegate " << delegate << " ns ("
+              << (HeimskrEngine::Delegate<void(uint32_t)>::StoresInline<Lambda> ? "inline" : "heap") << ", checksum " << sum << ")" << std::endl;
+  }
+}
+
+void BenchmarkDelegates() {
+  constexpr uint32_t iterations = 1000000u;
+  constexpr uint32_t tasksPerPoll = 1000u;
+
+  // Beyond the small-object buffer of std::function (16 to 24 bytes on the common standard libraries), it allocates.
+  BenchmarkCapture<8u>(iterations);
+  BenchmarkCapture<24u>(iterations);
+  BenchmarkCapture<40u>(iterations);
+  BenchmarkCapture<96u>(iterations);
+
+  // The task queue of the dispatcher, warmed up by the first poll.
+  HeimskrEngine::EventDispatcher dispatcher;
+  uint64_t sum = 0u;
+  std::array<uint64_t, 4> capture { 1u, 2u, 3u, 4u };
+  const double task = MeasureNanoseconds(iterations / tasksPerPoll, [&](uint32_t) {
+    for (uint32_t index = 0u; index < tasksPerPoll; ++index) {
+      dispatcher.PostTask([capture, &sum] { sum += capture[3]; });
+    }
+    dispatcher.PollEvents();
+  }) / tasksPerPoll;
+  std::cout << "Dispatcher task with a 40 bytes capture: " << task << " ns per post and run (checksum " << sum << ")" << std::endl;
+}
@@ -0,0 +1,64 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../src/core/JobSystem.h"
+
+namespace {
+  template<typename Function>
+  double MeasureMilliseconds(uint32_t iterations, Function&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t iteration = 0u; iteration < iterations; ++iteration) {
+      function();
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+  }
+}
+
+void BenchmarkJobSystem() {
+  constexpr uint32_t count = 1u << 22;
+  constexpr uint32_t grain = 16u * 1024u;
+  constexpr uint32_t iterations = 10u;
+  constexpr uint32_t emptyJobs = 100000u;
+
+  std::vector<float> values(count);
+  for (uint32_t index = 0u; index < count; ++index) {
+    values[index] = static_cast<float>(index % 1024u) * 0.01f;
+  }
+
+  auto map = [&values](uint32_t begin, uint32_t end) {
+    double sum = 0.0;
+    for (uint32_t index = begin; index < end; ++index) {
+      sum += std::sqrt(values[index]) * std::sin(values[index]);
+    }
+    return sum;
+  };
+
+  double expected = 0.0;
+  const double serial = MeasureMilliseconds(iterations, [&] { expected = map(0u, count); });
+  std::cout << "Serial reduce: " << serial << " ms" << std::endl;
+
+  const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  for (uint32_t threads = 1u; threads <= hardwareThreads; threads = threads * 2u > hardwareThreads && threads != hardwareThreads ? hardwareThreads : threads * 2u) {
+    HeimskrEngine::JobSystem jobs(threads);
+
+    double result = 0.0;
+    const double reduce = MeasureMilliseconds(iterations, [&] {
+      result = jobs.ParallelReduce(count, grain, 0.0, map, [](double a, double b) { return a + b; });
+    });
+
+    const double spawn = MeasureMilliseconds(1u, [&] {
+      HeimskrEngine::JobCounter counter;
+      for (uint32_t job = 0u; job < emptyJobs; ++job) {
+        jobs.Run([] {}, &counter);
+      }
+      jobs.Wait(counter);
+    });
+
+    std::cout << threads << " threads: reduce " << reduce << " ms (x" << serial / reduce << " speedup, "
+              << (std::abs(result - expected) < 1e-6 * std::abs(expected) ? "valid" : "INVALID") << "), "
+              << spawn * 1e6 / emptyJobs << " ns per empty job" << std::endl;
+  }
+}